@@ -0,0 +1,116 @@
+/*
+ * bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Bus time benchmarks, see bench.h
+ */
+#include <string.h>
+#include "global.h"
+#include "hal.h"
+#include "rprintf.h"
+#include "onewire.h"
+#include "bench.h"
+
+static void (*BenchOutput)(unsigned char c);
+static uint16_t BenchOut;
+static uint32_t BenchStartTicks;
+static uint32_t BenchStartCpu;
+
+static void BenchCount(unsigned char c)
+{
+	BenchOut++;
+}
+
+void benchInit(void (*output)(unsigned char c))
+{
+	BenchOutput = output;
+}
+
+static void benchStart(void)
+{
+	BenchOut = 0;
+	rprintfInit(BenchCount);
+	BenchStartCpu = hal_cpu_ticks();
+	BenchStartTicks = hal_ticks();
+}
+
+static void benchStop(BenchResult_t *r, uint16_t count)
+{
+	r->bus_us = (hal_ticks() - BenchStartTicks) / HAL_TICKS_PER_US;
+	r->cpu    = hal_cpu_ticks() - BenchStartCpu;
+	r->out    = BenchOut;
+	r->count  = count;
+	rprintfInit(BenchOutput);
+}
+
+void benchSearch(BenchResult_t *r)
+{
+	uint16_t found = 0;
+
+	benchStart();
+	therm_search_init();
+	if (OWFirst())
+		do
+			found++;
+		while (OWNext());
+	benchStop(r, found);
+}
+
+void benchSweep(BenchResult_t *r, uint8_t (*roms)[8], uint16_t n)
+{
+	int16_t t[2];
+	uint16_t i, read = 0;
+
+	if (roms == 0)
+		n = THERM_REGISTRY_SIZE;
+	benchStart();
+	for (i = 0; i < n; i++)
+	{
+		if (roms)
+			therm_set_devID(roms[i]);
+		else if (!therm_load_devID(i))
+			continue;
+		read++;
+		therm_print_devID();
+		rprintfChar(',');
+		therm_read_result(t);
+		rprintfChar(',');
+		therm_print_scratchpad();
+	}
+	benchStop(r, read);
+}
+
+// READ ROM replaces the selected device, which is restored afterwards
+void benchReadRom(BenchResult_t *r)
+{
+	uint8_t ok, rom[8];
+
+	memcpy(rom, therm_get_devID(), 8);
+	benchStart();
+	ok = therm_read_devID();
+	benchStop(r, ok);
+	therm_set_devID(rom);
+}
+
+void benchPage(BenchResult_t *r)
+{
+	benchStart();
+	recal_memory_page(0);
+	benchStop(r, 9);
+}
+
+void benchCrc(BenchResult_t *r, uint16_t loops)
+{
+	uint8_t sp[9] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0x1C};
+	uint8_t crc[1];
+	uint16_t i;
+
+	benchStart();
+	for (i = 0; i < loops; i++)
+	{
+		crc[0] = 0;
+		therm_crc_is_OK(sp, crc, 8);
+	}
+	benchStop(r, loops);
+}
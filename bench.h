@@ -0,0 +1,43 @@
+/*
+ * bench.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Bus time benchmarks for onewire.c, shared by the on-target "bench"
+ * command and the host suite (host/owbench.c).
+ * Each benchmark runs one operation on the current pin and reports
+ *  - bus_us : elapsed microseconds (from hal_ticks)
+ *  - cpu    : hal_cpu_ticks(), CPU cycles on the AVR, CPU ns on the host
+ *  - out    : bytes the operation printed (counted, not sent)
+ *  - count  : devices found/read, or CRCs computed
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "global.h"
+
+typedef struct
+{
+	uint32_t bus_us;
+	uint32_t cpu;
+	uint16_t out;
+	uint16_t count;
+} BenchResult_t;
+
+// output function restored after each benchmark
+void benchInit(void (*output)(unsigned char c));
+
+// full search of the current pin
+void benchSearch(BenchResult_t *r);
+// read every device once, as GetTemperature prints it in JSON mode;
+// roms == 0 reads the eeprom registry of the current pin
+void benchSweep(BenchResult_t *r, uint8_t (*roms)[8], uint16_t n);
+// READ ROM of a single device
+void benchReadRom(BenchResult_t *r);
+// recall and read DS2438 page 0 (single device, SKIP ROM)
+void benchPage(BenchResult_t *r);
+// CRC of a 9 byte scratchpad, <loops> times
+void benchCrc(BenchResult_t *r, uint16_t loops);
+
+#endif /* BENCH_H_ */
@@ -17,7 +17,6 @@
 
 #include "buffer.h"
 #include "global.h"
-#include "avr/io.h"
 
 #ifndef CRITICAL_SECTION_START
 #define CRITICAL_SECTION_START	unsigned char _sreg = SREG; cli()
@@ -20,13 +20,9 @@
 //*****************************************************************************
 
 //----- Include Files ---------------------------------------------------------
-#include <avr/io.h>			// include I/O definitions (port names, pin names, etc)
-#include <avr/interrupt.h>	// include interrupt support
-#include <avr/pgmspace.h>	// include AVR program memory support
 #include <string.h>			// include standard C string functions
-#include <stdlib.h>			// include stdlib for string conversion functions
 
-#include "global.h"		// include our global settings
+#include "global.h"		// include our global settings (and hal.h: pgmspace, eeprom)
 #include "cmdline.h"
 #include "rprintf.h"
 
@@ -50,6 +46,11 @@
 #define CMDLINE_HISTORY_PREV	1
 #define CMDLINE_HISTORY_NEXT	2
 
+// command separator for multiple commands on one line
+#define CMDLINE_SEPARATOR		';'
+// maximum number of macro expansions per entered line (stops recursive macros)
+#define CMDLINE_MAX_EXPANSIONS	4
+
 
 // Global variables
 
@@ -57,12 +58,18 @@
 const u08 PROGMEM CmdlinePrompt[] = "cmd>";
 const u08 PROGMEM CmdlineNotice[] = "ERROR: ";
 const u08 PROGMEM CmdlineCmdNotFound[] = "command not found";
+const u08 PROGMEM CmdlineBadRequestId[] = "request id above 65535";
+const u08 PROGMEM CmdlineMacroCmd[] = "macro";
 
 static long cmd_prompt_index;
+// index printed in the current JSON response frame <id>{...}</id>
+// -the host-supplied request ID when the line started with #<id>,
+//  otherwise the running cmd_prompt_index
+static u16 CmdlineResponseId;
 
 // command list
-// -commands are null-terminated strings
-static char CmdlineCommandList[CMDLINE_MAX_COMMANDS][CMDLINE_MAX_CMD_LENGTH];
+// -commands are null-terminated strings, kept where the caller put them
+static char* CmdlineCommandList[CMDLINE_MAX_COMMANDS];
 // command function pointer list
 static CmdlineFuncPtrType CmdlineFunctionList[CMDLINE_MAX_COMMANDS];
 // number of commands currently registered
@@ -75,6 +82,27 @@ u08 CmdlineInputVT100State;
 u08 CmdlineHistory[CMDLINE_HISTORYSIZE][CMDLINE_BUFFERSIZE];
 CmdlineFuncPtrType CmdlineExecFunction;
 
+// argument table, filled in a single pass by cmdlineTokenize() on [ENTER]
+// -CmdlineArgIndex holds the buffer offset of each argument
+// -CmdlineArgValue holds its decimal integer interpretation
+// unused entries point at the terminating null and read as zero
+static u08 CmdlineArgc;
+static u08 CmdlineArgEnd;
+static u08 CmdlineArgIndex[CMDLINE_MAX_ARGS];
+static long CmdlineArgValue[CMDLINE_MAX_ARGS];
+
+// command batching
+// -CmdlineNextIndex is the buffer offset of the next command on the line (0 = none)
+// -CmdlineBatch is set while a multi-command line is executing
+static u08 CmdlineNextIndex;
+static u08 CmdlineBatch;
+static u08 CmdlineBatchItems;
+static u08 CmdlineExpansions;
+
+// macro storage
+u08 EEMEM CmdlineMacroName[CMDLINE_MAX_MACROS][CMDLINE_MAX_CMD_LENGTH];
+u08 EEMEM CmdlineMacroBody[CMDLINE_MAX_MACROS][CMDLINE_MACRO_LENGTH];
+
 // Functions
 
 // function pointer to single character output routine
@@ -92,12 +120,23 @@ void cmdlineInit(void)
 	// initialize command list
 	CmdlineNumCommands = 0;
 	cmd_prompt_index = 0;
+	// initialize argument table
+	CmdlineArgc = 0;
+	CmdlineArgEnd = 0;
+	// initialize batch state
+	CmdlineNextIndex = 0;
+	CmdlineBatch = 0;
+	// register built-in commands
+	cmdlineAddCommand((u08*)"macro", cmdlineMacroCommand);
 }
 
 void cmdlineAddCommand(u08* newCmdString, CmdlineFuncPtrType newCmdFuncPtr)
 {
+	// ignore commands that do not fit the table (see CMDLINE_MAX_COMMANDS)
+	if(CmdlineNumCommands >= CMDLINE_MAX_COMMANDS)
+		return;
 	// add command string to end of command list
-	strcpy(CmdlineCommandList[CmdlineNumCommands], newCmdString);
+	CmdlineCommandList[CmdlineNumCommands] = (char*)newCmdString;
 	// add command function ptr to end of function list
 	CmdlineFunctionList[CmdlineNumCommands] = newCmdFuncPtr;
 	// increment number of registered commands
@@ -197,7 +236,9 @@ void cmdlineInputFunc(unsigned char c)
 		if(CmdlineBufferEditPos == CmdlineBufferLength)
 		{
 			// echo character to the output
-			cmdlineOutputFunc(c);
+			// (in JSON mode the line is echoed in the response header instead)
+			if(!Flags.print_json)
+				cmdlineOutputFunc(c);
 			// add it to the command line buffer
 			CmdlineBuffer[CmdlineBufferEditPos++] = c;
 			// update buffer length
@@ -243,9 +284,12 @@ void cmdlineInputFunc(unsigned char c)
 			{
 				// destructive backspace
 				// echo backspace-space-backspace
-				cmdlineOutputFunc(ASCII_BS);
-				cmdlineOutputFunc(' ');
-				cmdlineOutputFunc(ASCII_BS);
+				if(!Flags.print_json)
+				{
+					cmdlineOutputFunc(ASCII_BS);
+					cmdlineOutputFunc(' ');
+					cmdlineOutputFunc(ASCII_BS);
+				}
 				// decrement our buffer length and edit position
 				CmdlineBufferLength--;
 				CmdlineBufferEditPos--;
@@ -301,14 +345,14 @@ void cmdlineDoHistory(u08 action)
 	{
 	case CMDLINE_HISTORY_SAVE:
 		// copy CmdlineBuffer to history if not null string
-		if( strlen(CmdlineBuffer) )
-			strcpy(CmdlineHistory[0], CmdlineBuffer);
+		if( strlen((char*)CmdlineBuffer) )
+			strcpy((char*)CmdlineHistory[0], (char*)CmdlineBuffer);
 		break;
 	case CMDLINE_HISTORY_PREV:
 		// copy history to current buffer
-		strcpy(CmdlineBuffer, CmdlineHistory[0]);
+		strcpy((char*)CmdlineBuffer, (char*)CmdlineHistory[0]);
 		// set the buffer position to the end of the line
-		CmdlineBufferLength = strlen(CmdlineBuffer);
+		CmdlineBufferLength = strlen((char*)CmdlineBuffer);
 		CmdlineBufferEditPos = CmdlineBufferLength;
 		// "re-paint" line
 		cmdlineRepaint();
@@ -320,37 +364,207 @@ void cmdlineDoHistory(u08 action)
 
 void cmdlineProcessInputString(void)
 {
-	u08 cmdIndex;
-	u08 i=0;
-
 	// save command in history
 	cmdlineDoHistory(CMDLINE_HISTORY_SAVE);
 
-	// find the end of the command (excluding arguments)
-	// find first whitespace character in CmdlineBuffer
-	while( !((CmdlineBuffer[i] == ' ') || (CmdlineBuffer[i] == 0)) ) i++;
+	// take the host-supplied request ID, if any; an ID that does not fit
+	// the response frame is refused rather than wrapped
+	if(!cmdlineTakeRequestId())
+	{
+		if(Flags.print_json)
+			cmdlinePrintResponseStart(CmdlineBuffer, STRING_IN_RAM);
+		else
+			rprintfCRLF();
+		cmdlinePrintNotice(CmdlineBadRequestId);
+		// output a new prompt, as after any other command
+		cmdlinePrintPrompt();
+		return;
+	}
 
-	if(!i)
+	if( (CmdlineBuffer[0] == 0) || (CmdlineBuffer[0] == ' ') )
 	{
 		// command was null or empty
 		// output a new prompt
 		if(Flags.print_json==0){
 			rprintfCRLF();
-			cmdlinePrintPrompt();			
+			cmdlinePrintPrompt();
 		}
 
 		// we're done
 		return;
 	}
 	if(Flags.print_json==1)
-		rprintfProgStrM("\", \"data\": ");
+	{
+		// response header echoes the command line
+		cmdlinePrintResponseStart(CmdlineBuffer, STRING_IN_RAM);
+	}
 	else
 		rprintfCRLF();
-	
+
+	CmdlineExpansions = 0;
+	CmdlineBatch = 0;
+	cmdlineSplitCommand();
+
+	// a line holding more than one command is answered as one framed response
+	if(CmdlineNextIndex)
+	{
+		CmdlineBatch = 1;
+		if(Flags.print_json)
+			json_open_bracket();
+	}
+
+	CmdlineBatchItems = 0;
+	if( (CmdlineBuffer[0] == 0) || (CmdlineBuffer[0] == ' ') )
+		cmdlineNextCommand();
+	else
+		cmdlineDispatch();
+}
+
+u08 cmdlineTakeRequestId(void)
+{
+	u08 i=1;
+	u32 id=0;
+
+	CmdlineResponseId = cmd_prompt_index;
+	if(CmdlineBuffer[0] != '#')
+		return 1;
+
+	// parse #<id> and strip it (and the following whitespace) from the line
+	while((CmdlineBuffer[i] >= '0') && (CmdlineBuffer[i] <= '9'))
+	{
+		id = id*10 + (CmdlineBuffer[i++] - '0');
+		if(id > 0xFFFF)
+			return 0;
+	}
+	while(CmdlineBuffer[i] == ' ') i++;
+	memmove(CmdlineBuffer, &CmdlineBuffer[i], strlen((char*)&CmdlineBuffer[i])+1);
+	CmdlineResponseId = id;
+	return 1;
+}
+
+// prints a character of a JSON string value, escaping quote and backslash
+static void cmdlineJsonChar(u08 c)
+{
+	if((c == '"') || (c == '\\'))
+		cmdlineOutputFunc('\\');
+	cmdlineOutputFunc(c);
+}
+
+void cmdlinePrintResponseStart(u08* cmd, u08 stringInRom)
+{
+	u08 c;
+
+	// open a JSON response frame: <id>{"cmd":"<cmd>", "data": 
+	if(!Flags.print_json)
+		return;
+	rprintfChar('<');
+	rprintfDecU16(CmdlineResponseId, 0, 0);
+	rprintfProgStrM(">{\"cmd\":\"");
+	// the echoed command line is a JSON string
+	while((c = stringInRom ? pgm_read_byte(cmd) : *cmd))
+	{
+		cmdlineJsonChar(c);
+		cmd++;
+	}
+	rprintfProgStrM("\", \"data\": ");
+}
+
+void cmdlineBeginResponse(const char* cmd)
+{
+	// unsolicited responses (e.g. streamed data) use the running index
+	CmdlineResponseId = cmd_prompt_index;
+	cmdlinePrintResponseStart((u08*)cmd, STRING_IN_ROM);
+}
+
+void cmdlineSplitCommand(void)
+{
+	u08 i=0;
+	u08 quoted;
+
+	// expand a macro at the start of the command, and again while the body
+	// starts with another macro (bounded by CMDLINE_MAX_EXPANSIONS)
+	while(cmdlineExpandMacro());
+
+	// the macro command keeps the rest of the line (separators included)
+	quoted = !strncmp_P((char*)CmdlineBuffer, (char*)CmdlineMacroCmd, sizeof(CmdlineMacroCmd)-1) &&
+		((CmdlineBuffer[sizeof(CmdlineMacroCmd)-1] == ' ') || (CmdlineBuffer[sizeof(CmdlineMacroCmd)-1] == 0));
+
+	// find the end of this command and terminate it
+	CmdlineNextIndex = 0;
+	while(CmdlineBuffer[i] != 0)
+	{
+		if((CmdlineBuffer[i] == CMDLINE_SEPARATOR) && !quoted)
+		{
+			CmdlineBuffer[i] = 0;
+			CmdlineNextIndex = i+1;
+			break;
+		}
+		i++;
+	}
+}
+
+u08 cmdlineExpandMacro(void)
+{
+	u08 name[CMDLINE_MAX_CMD_LENGTH];
+	u08 len=0, tail, bodylen, i, m;
+
+	// find the end of the command name
+	while( !((CmdlineBuffer[len] == ' ') || (CmdlineBuffer[len] == CMDLINE_SEPARATOR) || (CmdlineBuffer[len] == 0)) ) len++;
+	if(!len || (len >= CMDLINE_MAX_CMD_LENGTH) || (CmdlineExpansions >= CMDLINE_MAX_EXPANSIONS))
+		return 0;
+
+	for(m=0; m<CMDLINE_MAX_MACROS; m++)
+	{
+		eeprom_read_block(name, CmdlineMacroName[m], CMDLINE_MAX_CMD_LENGTH);
+		if( (name[len] == 0) && !strncmp((char*)name, (char*)CmdlineBuffer, len) )
+			break;
+	}
+	if(m == CMDLINE_MAX_MACROS)
+		return 0;
+	CmdlineExpansions++;
+
+	// macro arguments are ignored, keep the commands that follow
+	tail = len;
+	while( (CmdlineBuffer[tail] != 0) && (CmdlineBuffer[tail] != CMDLINE_SEPARATOR) ) tail++;
+
+	// find the body length
+	bodylen = 0;
+	while( (bodylen < CMDLINE_MACRO_LENGTH-1) && eeprom_read_byte(&CmdlineMacroBody[m][bodylen]) ) bodylen++;
+
+	// move the remaining commands behind the body (truncating if necessary)
+	i = strlen((char*)&CmdlineBuffer[tail]);
+	if(bodylen + i >= CMDLINE_BUFFERSIZE)
+		i = CMDLINE_BUFFERSIZE-1 - bodylen;
+	memmove(&CmdlineBuffer[bodylen], &CmdlineBuffer[tail], i);
+	CmdlineBuffer[bodylen+i] = 0;
+	eeprom_read_block(CmdlineBuffer, CmdlineMacroBody[m], bodylen);
+	return 1;
+}
+
+void cmdlineDispatch(void)
+{
+	u08 cmdIndex;
+	u08 i=0;
+
+	// find the end of the command (excluding arguments)
+	// find first whitespace character in CmdlineBuffer
+	while( !((CmdlineBuffer[i] == ' ') || (CmdlineBuffer[i] == 0)) ) i++;
+
+	// split the command into arguments once, so handlers can fetch them directly
+	cmdlineTokenize();
+	// separate the outputs of batched commands
+	if(CmdlineBatch && CmdlineBatchItems++)
+	{
+		if(Flags.print_json)
+			json_comma();
+		else
+			rprintfCRLF();
+	}
+
 	// search command list for match with entered command
 	for(cmdIndex=0; cmdIndex<CmdlineNumCommands; cmdIndex++)
 	{
-		if( !strncmp(CmdlineCommandList[cmdIndex], CmdlineBuffer, i) )
+		if( i && !strncmp(CmdlineCommandList[cmdIndex], (char*)CmdlineBuffer, i) )
 		{
 			// user-entered command matched a command in the list (database)
 			// run the corresponding function
@@ -362,12 +576,50 @@ void cmdlineProcessInputString(void)
 	}
 
 	// if we did not get a match
-	// output an error message
-	cmdlinePrintError();
-	// output a new prompt
+	// output an error message (and a new prompt) from the main loop
+	CmdlineExecFunction = cmdlinePrintError;
+}
+
+void cmdlineNextCommand(void)
+{
+	u08 i;
+
+	// skip empty commands
+	while(CmdlineNextIndex)
+	{
+		// skip leading whitespace
+		while(CmdlineBuffer[CmdlineNextIndex] == ' ') CmdlineNextIndex++;
+		// move the next command to the start of the buffer
+		i = 0;
+		do {
+			CmdlineBuffer[i] = CmdlineBuffer[CmdlineNextIndex+i];
+		} while(CmdlineBuffer[i++]);
+
+		cmdlineSplitCommand();
+		if(CmdlineBuffer[0])
+		{
+			cmdlineDispatch();
+			return;
+		}
+	}
+
+	// batch is complete, close the response frame
+	if(CmdlineBatch)
+	{
+		CmdlineBatch = 0;
+		if(Flags.print_json)
+			json_end_bracket();
+		cmdlinePrintPromptEnd();
+	}
+	// output new prompt
 	cmdlinePrintPrompt();
 }
 
+u08 cmdlineIsBusy(void)
+{
+	return (CmdlineExecFunction != 0) || CmdlineBatch;
+}
+
 void cmdlineMainLoop(void)
 {
 	// do we have a command/function to be executed
@@ -377,19 +629,18 @@ void cmdlineMainLoop(void)
 		CmdlineExecFunction();
 		// reset
 		CmdlineExecFunction = 0;
-		// output new prompt
-		cmdlinePrintPrompt();
+		// continue with the next command on the line, or output new prompt
+		cmdlineNextCommand();
 	}
 }
 
 void cmdlinePrintPrompt(void)
 {
 	// print a new command prompt
-	u08* ptr = CmdlinePrompt;
+	u08* ptr = (u08*)CmdlinePrompt;
 	
-	if(Flags.print_json)
-		rprintf("<%d>{\"cmd\":\"",cmd_prompt_index);
-	else{
+	// in JSON mode the response frame is opened when the command arrives
+	if(!Flags.print_json){
 		while(pgm_read_byte(ptr)) cmdlineOutputFunc( pgm_read_byte(ptr++) );		
 	}
 }
@@ -403,8 +654,13 @@ void cmdlineResetPrompt(void)
 }
 void cmdlinePrintPromptEnd(void)
 {
+	// commands of a batch share the response frame closed by cmdlineNextCommand()
+	if(CmdlineBatch)
+		return;
 	if(Flags.print_json){
-		rprintf("}</%d>",cmd_prompt_index);
+		rprintfProgStrM("}</");
+		rprintfDecU16(CmdlineResponseId, 0, 0);
+		rprintfChar('>');
 		rprintfCRLF();
 	}
 	else
@@ -415,10 +671,15 @@ void cmdlinePrintPromptEnd(void)
 }
 
 void cmdlinePrintError(void)
+{
+	cmdlinePrintNotice(CmdlineCmdNotFound);
+}
+
+void cmdlinePrintNotice(const u08* msg)
 {
 	u08 * ptr;
 	if(Flags.print_json)
-		rprintf("\"",cmd_prompt_index);
+		rprintf("\"");
 	// print a notice header
 	// (u08*) cast used to avoid compiler warning
 	ptr = (u08*)CmdlineNotice;
@@ -426,14 +687,20 @@ void cmdlinePrintError(void)
 
 	// print the offending command
 	ptr = CmdlineBuffer;
-	while((*ptr) && (*ptr != ' ')) cmdlineOutputFunc(*ptr++);
+	while((*ptr) && (*ptr != ' '))
+	{
+		if(Flags.print_json)
+			cmdlineJsonChar(*ptr++);
+		else
+			cmdlineOutputFunc(*ptr++);
+	}
 
 	cmdlineOutputFunc(':');
 	cmdlineOutputFunc(' ');
 
-	// print the not-found message
+	// print the message
 	// (u08*) cast used to avoid compiler warning
-	ptr = (u08*)CmdlineCmdNotFound;
+	ptr = (u08*)msg;
 	while(pgm_read_byte(ptr)) cmdlineOutputFunc( pgm_read_byte(ptr++) );
 
 	if(Flags.print_json)
@@ -441,41 +708,181 @@ void cmdlinePrintError(void)
 	cmdlinePrintPromptEnd();
 }
 
+void cmdlineMacroCommand(void)
+{
+	u08 name[CMDLINE_MAX_CMD_LENGTH];
+	u08* newName = cmdlineGetArgStr(1);
+	u08* body = cmdlineGetArgStr(2);
+	u08 len=0, m, c, i;
+
+	// no arguments: list the stored macros
+	if(!*newName)
+	{
+		json_open_bracket();
+		len = 0;
+		for(m=0; m<CMDLINE_MAX_MACROS; m++)
+		{
+			eeprom_read_block(name, CmdlineMacroName[m], CMDLINE_MAX_CMD_LENGTH);
+			if((name[0] == 0) || (name[0] == 0xFF))
+				continue;
+			name[CMDLINE_MAX_CMD_LENGTH-1] = 0;
+			if(len++) json_comma();
+			// names and bodies are JSON strings
+			rprintfProgStrM("[\"");
+			for(i=0; name[i]; i++)
+				cmdlineJsonChar(name[i]);
+			rprintfProgStrM("\",\"");
+			for(i=0; i<CMDLINE_MACRO_LENGTH-1; i++)
+			{
+				c = eeprom_read_byte(&CmdlineMacroBody[m][i]);
+				if((c == 0) || (c == 0xFF)) break;
+				cmdlineJsonChar(c);
+			}
+			rprintfProgStrM("\"]");
+		}
+		json_end_bracket();
+		cmdlinePrintPromptEnd();
+		return;
+	}
+
+	while( (newName[len] != ' ') && (newName[len] != 0) ) len++;
+	if( (len >= CMDLINE_MAX_CMD_LENGTH) || (strlen((char*)body) >= CMDLINE_MACRO_LENGTH) )
+	{
+		rprintfProgStrM("\"ERROR - macro name or body too long\"");
+		cmdlinePrintPromptEnd();
+		return;
+	}
+
+	// find the macro to replace, or a free slot
+	for(m=0; m<CMDLINE_MAX_MACROS; m++)
+	{
+		eeprom_read_block(name, CmdlineMacroName[m], CMDLINE_MAX_CMD_LENGTH);
+		if( (name[len] == 0) && !strncmp((char*)name, (char*)newName, len) )
+			break;
+	}
+	if(m == CMDLINE_MAX_MACROS)
+	{
+		for(m=0; m<CMDLINE_MAX_MACROS; m++)
+		{
+			c = eeprom_read_byte(&CmdlineMacroName[m][0]);
+			if((c == 0) || (c == 0xFF))
+				break;
+		}
+	}
+	if(m == CMDLINE_MAX_MACROS)
+	{
+		rprintfProgStrM("\"ERROR - no free macro slot\"");
+		cmdlinePrintPromptEnd();
+		return;
+	}
+
+	// an empty body deletes the macro, only its first name byte is cleared
+	if(*body)
+	{
+		memcpy(name, newName, len);
+		name[len] = 0;
+		eeprom_write_block(name, CmdlineMacroName[m], len+1);
+	}
+	else
+		eeprom_write_byte(&CmdlineMacroName[m][0], 0);
+	eeprom_write_block(body, CmdlineMacroBody[m], strlen((char*)body)+1);
+	rprintfProgStrM("\"OK\"");
+	cmdlinePrintPromptEnd();
+}
+
 // argument retrieval commands
 
-// return string pointer to argument [argnum]
-u08* cmdlineGetArgStr(u08 argnum)
+void cmdlineTokenize(void)
 {
-	// find the offset of argument number [argnum]
 	u08 idx=0;
 	u08 arg;
+	u08 neg;
+	long value;
 
-	// find the first non-whitespace character
-	while( (CmdlineBuffer[idx] != 0) && (CmdlineBuffer[idx] == ' ')) idx++;
-
-	// we are at the first argument
-	for(arg=0; arg<argnum; arg++)
+	CmdlineArgc = 0;
+	while(CmdlineBuffer[idx] != 0)
 	{
-		// find the next whitespace character
-		while( (CmdlineBuffer[idx] != 0) && (CmdlineBuffer[idx] != ' ')) idx++;
 		// find the first non-whitespace character
-		while( (CmdlineBuffer[idx] != 0) && (CmdlineBuffer[idx] == ' ')) idx++;
+		if(CmdlineBuffer[idx] == ' ')
+		{
+			idx++;
+			continue;
+		}
+		// stop recording once the table is full (later arguments read as empty)
+		if(CmdlineArgc >= CMDLINE_MAX_ARGS)
+			break;
+		CmdlineArgIndex[CmdlineArgc] = idx;
+
+		// parse the leading decimal number of the argument (strtol semantics)
+		neg = 0;
+		value = 0;
+		if((CmdlineBuffer[idx] == '-') || (CmdlineBuffer[idx] == '+'))
+			neg = (CmdlineBuffer[idx++] == '-');
+		while((CmdlineBuffer[idx] >= '0') && (CmdlineBuffer[idx] <= '9'))
+			value = value*10 + (CmdlineBuffer[idx++] - '0');
+		CmdlineArgValue[CmdlineArgc++] = neg ? -value : value;
+
+		// find the next whitespace character
+		while((CmdlineBuffer[idx] != 0) && (CmdlineBuffer[idx] != ' ')) idx++;
 	}
+	// unused arguments point at the end of the buffer
+	while(CmdlineBuffer[idx] != 0) idx++;
+	CmdlineArgEnd = idx;
+	for(arg=CmdlineArgc; arg<CMDLINE_MAX_ARGS; arg++)
+	{
+		CmdlineArgIndex[arg] = idx;
+		CmdlineArgValue[arg] = 0;
+	}
+}
+
+u08 cmdlineGetArgc(void)
+{
+	return CmdlineArgc;
+}
+
+// return string pointer to argument [argnum]
+u08* cmdlineGetArgStr(u08 argnum)
+{
+	// arguments beyond the table point at the terminating null
+	if(argnum >= CMDLINE_MAX_ARGS)
+		return &CmdlineBuffer[CmdlineArgEnd];
 	// we are at the requested argument or the end of the buffer
-	return &CmdlineBuffer[idx];
+	return &CmdlineBuffer[CmdlineArgIndex[argnum]];
 }
 
 // return argument [argnum] interpreted as a decimal integer
 long cmdlineGetArgInt(u08 argnum)
 {
-	char* endptr;
-	return strtol(cmdlineGetArgStr(argnum), &endptr, 10);
+	if(argnum >= CMDLINE_MAX_ARGS)
+		return 0;
+	return CmdlineArgValue[argnum];
 }
 
 // return argument [argnum] interpreted as a hex integer
 long cmdlineGetArgHex(u08 argnum)
 {
-	char* endptr;
-	return strtol(cmdlineGetArgStr(argnum), &endptr, 16);
+	u08* ptr = cmdlineGetArgStr(argnum);
+	u08 neg = 0;
+	u08 digit;
+	long value = 0;
+
+	if((*ptr == '-') || (*ptr == '+'))
+		neg = (*ptr++ == '-');
+	// skip optional 0x prefix
+	if((ptr[0] == '0') && ((ptr[1] == 'x') || (ptr[1] == 'X')))
+		ptr += 2;
+	while(1)
+	{
+		if((*ptr >= '0') && (*ptr <= '9'))
+			digit = *ptr - '0';
+		else if((*ptr >= 'a') && (*ptr <= 'f'))
+			digit = *ptr - 'a' + 10;
+		else if((*ptr >= 'A') && (*ptr <= 'F'))
+			digit = *ptr - 'A' + 10;
+		else
+			break;
+		value = (value<<4) | digit;
+		ptr++;
+	}
+	return neg ? -value : value;
 }
-
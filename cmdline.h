@@ -43,6 +43,17 @@
 ///		- Mid-line editing, inserting and deleting (left/right-arrows)
 ///		- Command History (up-arrow) (currently only one command deep)
 ///
+///	Several commands may be entered on one line separated by ';', and a
+///	sequence of commands may be stored in eeprom as a macro with the built-in
+///	"macro" command.  Entering the macro name runs the stored commands.
+///	In JSON mode the outputs of a multi-command line are returned as one
+///	array in a single response frame.
+///
+///	In JSON mode each response is framed as <id>{"cmd":"...", "data": ...}</id>.
+///	A line may start with #<id> to supply the request ID used in the frame, so
+///	a host can send requests ahead of the responses and match them up.  Lines
+///	wait in the uart receive buffer while the previous command executes.
+///
 ///	To use the cmdline system, you will need to associate command strings
 ///	(commands the user will be typing) with your function that you wish to have
 ///	called when the user enters that command.  This is done by using the
@@ -91,7 +102,8 @@ typedef void (*CmdlineFuncPtrType)(void);
 void cmdlineInit(void);
 
 //! add a new command to the database of known commands
-// newCmdString should be a null-terminated command string with no whitespace
+// newCmdString should be a null-terminated command string with no whitespace,
+//   it is not copied and must stay valid (a string literal)
 // newCmdFuncPtr should be a pointer to the function to execute when
 //   the user enters the corresponding command tring
 void cmdlineAddCommand(u08* newCmdString, CmdlineFuncPtrType newCmdFuncPtr);
@@ -105,18 +117,46 @@ void cmdlineInputFunc(unsigned char c);
 //! call this function in your program's main loop
 void cmdlineMainLoop(void);
 
+//! returns non-zero while a command (or a line of ';'-separated commands)
+//! is still executing; stop passing input to cmdlineInputFunc() until it clears
+u08 cmdlineIsBusy(void);
+
+//! built-in "macro" command
+// macro                    : list the stored macros
+// macro name cmd1;cmd2;... : store (or replace) a macro
+// macro name               : delete a macro
+void cmdlineMacroCommand(void);
+
 // internal commands
 void cmdlineRepaint(void);
 void cmdlineDoHistory(u08 action);
 void cmdlineProcessInputString(void);
+// takes #<id> off the line, returns 0 for an ID above 65535
+u08 cmdlineTakeRequestId(void);
+void cmdlinePrintResponseStart(u08* cmd, u08 stringInRom);
+void cmdlineSplitCommand(void);
+// replaces a macro name at the start of the buffer by its body, returns 1 if it did
+u08 cmdlineExpandMacro(void);
+void cmdlineDispatch(void);
+void cmdlineNextCommand(void);
+void cmdlineTokenize(void);
 void cmdlinePrintPrompt(void);
 void cmdlinePrintError(void);
+// error notice for the command at the start of the buffer, msg in program memory
+void cmdlinePrintNotice(const u08* msg);
 
 void cmdlineIncrementPrompt(void);
 void cmdlineResetPrompt(void);
 void cmdlinePrintPromptEnd(void);
 
+//! opens a JSON response frame for output not requested by a command
+// (e.g. streamed data); cmd is a PSTR() name, close with cmdlinePrintPromptEnd()
+void cmdlineBeginResponse(const char* cmd);
+
 // argument retrieval commands
+// (arguments are tokenized once when [ENTER] is pressed, so these are O(1))
+//! returns the number of arguments on the command line (including the command)
+u08 cmdlineGetArgc(void);
 //! returns a string pointer to argument number [argnum] on the command line
 u08* cmdlineGetArgStr(u08 argnum);
 //! returns the decimal integer interpretation of argument number [argnum]
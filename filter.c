@@ -0,0 +1,164 @@
+/*
+ * filter.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Per slot filters for streamed readings, see filter.h
+ */
+#include <string.h>
+#include "global.h"
+#include "onewire.h"
+#include "filter.h"
+
+typedef struct
+{
+	uint8_t setting;	// type in the high nibble, param in the low nibble
+	uint8_t base;		// first sample of the window in FilterPool
+	uint8_t count;		// samples in the window, 0 = not started
+	uint8_t pos;		// next sample to overwrite
+} Filter_t;
+
+static Filter_t Filters[THERM_REGISTRY_SIZE];
+// the windows in slot order; an EMA keeps its state (1/256 C) here
+static int16_t  FilterPool[FILTER_POOL];
+
+static uint8_t filterSize(uint8_t setting)
+{
+	switch (setting >> 4)
+	{
+	case FILTER_MEAN:
+	case FILTER_MEDIAN:
+		return setting & 0x0f;
+	case FILTER_EMA:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+// lays the windows out in slot order, returns the samples they take
+static uint8_t filterLayout(void)
+{
+	uint8_t i, used = 0;
+
+	for (i = 0; i < THERM_REGISTRY_SIZE; i++)
+	{
+		Filters[i].base = used;
+		used += filterSize(Filters[i].setting);
+	}
+	filterReset();
+	return used;
+}
+
+uint8_t filterSet(uint8_t slot, uint8_t type, uint8_t param)
+{
+	if (slot >= THERM_REGISTRY_SIZE || type >= FILTER_TYPES)
+		return 0;
+	if (type == FILTER_MEAN && param < 2)
+		param = 2;
+	if (type == FILTER_MEDIAN && param < 3)
+		param = 3;
+	if (param > FILTER_MAX_N)
+		param = FILTER_MAX_N;
+	if (type == FILTER_EMA && (param < 1 || param > 7))
+		param = 1;
+	Filters[slot].setting = (type << 4) | param;
+	if (filterLayout() <= FILTER_POOL)
+		return 1;
+	Filters[slot].setting = FILTER_NONE;
+	filterLayout();
+	return 0;
+}
+
+uint8_t filterGetType(uint8_t slot)
+{
+	return Filters[slot].setting >> 4;
+}
+
+uint8_t filterGetParam(uint8_t slot)
+{
+	return Filters[slot].setting & 0x0f;
+}
+
+void filterReset(void)
+{
+	uint8_t i;
+	for (i = 0; i < THERM_REGISTRY_SIZE; i++)
+	{
+		Filters[i].count = 0;
+		Filters[i].pos   = 0;
+	}
+}
+
+void filterClear(void)
+{
+	memset(Filters, 0, sizeof(Filters));
+}
+
+// median of n samples: insertion sort of a copy, the mean of the middle
+// two for an even n
+static int16_t filterMedian(const int16_t *w, uint8_t n)
+{
+	int16_t s[FILTER_MAX_N], x;
+	uint8_t i, j;
+
+	for (i = 0; i < n; i++)
+	{
+		x = w[i];
+		for (j = i; j && s[j - 1] > x; j--)
+			s[j] = s[j - 1];
+		s[j] = x;
+	}
+	if (n & 1)
+		return s[n / 2];
+	return (s[n / 2 - 1] + s[n / 2]) >> 1;
+}
+
+uint8_t filterPut(uint8_t slot, int16_t *value)
+{
+	Filter_t *f = &Filters[slot];
+	int16_t *w = &FilterPool[f->base];
+	uint8_t i, param = f->setting & 0x0f;
+	int16_t x = *value;
+	int32_t sum;
+
+	switch (f->setting >> 4)
+	{
+	case FILTER_MEAN:
+	case FILTER_MEDIAN:
+		w[f->pos] = x;
+		if (++f->pos == param)
+			f->pos = 0;
+		if (f->count < param)
+			f->count++;
+		// nothing while the window fills
+		if (f->count < param)
+			return 0;
+		if ((f->setting >> 4) == FILTER_MEDIAN)
+		{
+			*value = filterMedian(w, param);
+			return 1;
+		}
+		sum = 0;
+		for (i = 0; i < param; i++)
+			sum += w[i];
+		// rounded to nearest
+		if (sum < 0)
+			*value = (sum - param / 2) / param;
+		else
+			*value = (sum + param / 2) / param;
+		return 1;
+	case FILTER_EMA:
+		if (f->count == 0)
+		{
+			w[0] = x << 4;
+			f->count = 1;
+		}
+		else
+			w[0] += (int16_t)(((int32_t) x * 16 - w[0]) >> param);
+		*value = (w[0] + 8) >> 4;
+		return 1;
+	default:
+		return 1;
+	}
+}
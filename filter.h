@@ -0,0 +1,47 @@
+/*
+ * filter.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Per slot filters for streamed readings, in fixed point (1/16 C).
+ * Each streamed conversion of the slot is one sample, so the devint period
+ * and the stream interval set the sample rate; there are no extra
+ * conversions for a filter. The window filters slide: once the window of
+ * <param> samples is full, every new sample gives one output.
+ *  - FILTER_MEAN    mean of the last <param> samples (2..15)
+ *  - FILTER_MEDIAN  median of the last <param> samples (3..15)
+ *  - FILTER_EMA     y += (x - y) / 2^<param> (1..7), one value per sample
+ * The windows share a pool of FILTER_POOL samples, an EMA takes one. A
+ * filter that does not fit is refused. Setting a filter restarts every
+ * filter, since the windows are laid out again.
+ * Settings are kept in RAM for the registry slots of the current pin.
+ */
+
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include "global.h"
+
+#define FILTER_NONE		0
+#define FILTER_MEAN		1
+#define FILTER_MEDIAN	2
+#define FILTER_EMA		3
+#define FILTER_TYPES	4
+
+// samples held for all windows, e.g. a median of 5 for 12 slots
+#define FILTER_POOL		64
+#define FILTER_MAX_N	15
+
+// returns 0 when the window does not fit, the slot is then unfiltered
+uint8_t filterSet(uint8_t slot, uint8_t type, uint8_t param);
+uint8_t filterGetType(uint8_t slot);
+uint8_t filterGetParam(uint8_t slot);
+// restarts every filter, the settings are kept
+void    filterReset(void);
+// turns every filter off
+void    filterClear(void);
+// feeds a sample, returns 1 with the filtered value in *value when the
+// filter has an output (always without a filter)
+uint8_t filterPut(uint8_t slot, int16_t *value);
+
+#endif /* FILTER_H_ */
@@ -7,7 +7,8 @@
 
 #ifndef GLOBAL_H_
 #define GLOBAL_H_
-#include <avr/io.h>
+// hardware abstraction (avr-libc headers on the target)
+#include "hal.h"
 // global AVRLIB defines
 #include "avrlibdefs.h"
 // global AVRLIB types definitions
@@ -20,26 +21,41 @@
 
 // size of command database
 // (maximum number of commands the cmdline system can handle)
-#define CMDLINE_MAX_COMMANDS	30
+#define CMDLINE_MAX_COMMANDS	38
 
 // maximum length (number of characters) of each command string
 // (quantity must include one additional byte for a null terminator)
-#define CMDLINE_MAX_CMD_LENGTH	8
+#define CMDLINE_MAX_CMD_LENGTH	10
 
 // allotted buffer size for command entry
 // (must be enough chars for typed commands and the arguments that follow)
 #define CMDLINE_BUFFERSIZE		80
 
+// maximum number of arguments (including the command itself) that are
+// tokenized when the user presses [ENTER]; later arguments read as empty
+#define CMDLINE_MAX_ARGS		12
+
 // number of lines of command history to keep
 // (each history buffer is CMDLINE_BUFFERSIZE in size)
 // ***** ONLY ONE LINE OF COMMAND HISTORY IS CURRENTLY SUPPORTED
 #define CMDLINE_HISTORYSIZE		2
 
+// number of command macros stored in eeprom, and the maximum length of a
+// macro body (including the null terminator); a macro name is limited to
+// CMDLINE_MAX_CMD_LENGTH like a regular command
+#define CMDLINE_MAX_MACROS		2
+#define CMDLINE_MACRO_LENGTH	48
+
+// uart receive buffer, also queues pipelined command lines from the host
+#define UART_RX_BUFFER_SIZE		0x0080
+
 #define DEBUG 0
-#define NUM_OF_ADCS 5
+
+// 1-Wire event trace in a RAM ring (trace.h, "trace" command), costs
+// TRACE_SIZE * 4 bytes of RAM and a few us per traced event; off by default
+//#define THERM_TRACE
 
 typedef struct {
-	uint8_t  print_temp;
 	uint8_t  print_json;
 	uint8_t  stream_timer_0;
 } Flags_t;
@@ -0,0 +1,84 @@
+/*
+ * hal.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Hardware abstraction for the firmware core (onewire, cmdline, buffer,
+ * rprintf). The core only touches the hardware through this header:
+ *  - 1-Wire bus pins: drive low, release to the pull-up, sample
+ *  - debug trigger pins
+ *  - delays in _delay_loop_2() loops and milliseconds, a microsecond clock,
+ *    cpu time for benchmarks
+ *  - critical sections that nest (the interrupt flag is saved and restored)
+ *  - EEPROM and program memory keep the avr-libc interface
+ *    (eeprom_read_byte(), pgm_read_byte(), EEMEM, PROGMEM, PSTR)
+ *
+ * On the AVR the pin and critical section calls are macros on the port
+ * registers, so the abstraction costs nothing; the rest is in hal_avr.c.
+ * Building with HAL_HOST selects host/hal_host.h instead, see host/Makefile.
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#ifdef HAL_HOST
+
+#include "host/hal_host.h"
+
+#else
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/delay_basic.h>
+
+// 1-Wire buses on PORTB (open drain: low = output 0, release = input)
+#define HAL_BUS_LOW(bit)		do { PORTB &= ~(1<<(bit)); DDRB |= (1<<(bit)); } while (0)
+#define HAL_BUS_RELEASE(bit)	DDRB &= ~(1<<(bit))
+#define HAL_BUS_READ(bit)		(PINB & (1<<(bit)))
+
+// debug trigger pins on PORTC
+#define HAL_TRIG_LOW(bit)		PORTC &= ~(1<<(bit))
+#define HAL_TRIG_HIGH(bit)		PORTC |= (1<<(bit))
+
+// busy wait, 4 cpu cycles per loop
+#define hal_delay_loops(loops)	_delay_loop_2(loops)
+
+// low word of the Timer1 timebase, for timestamps inside a slot
+#define HAL_TICKS16()			TCNT1
+
+// critical sections
+typedef uint8_t hal_irq_t;
+
+static inline hal_irq_t hal_irq_save(void)
+{
+	hal_irq_t sreg = SREG;
+	cli();
+	return sreg;
+}
+
+static inline void hal_irq_restore(hal_irq_t sreg)
+{
+	SREG = sreg;
+}
+
+#endif
+
+#define CRITICAL_SECTION_START	hal_irq_t _sreg = hal_irq_save()
+#define CRITICAL_SECTION_END	hal_irq_restore(_sreg)
+
+// idle wait, keeps interrupts serviced
+void     hal_delay_ms(uint16_t ms);
+// free running microsecond clock; on the AVR it is hal_ticks() / 2 and
+// wraps at 2^31 us (about 36 minutes), so time spans use hal_ticks()
+uint32_t hal_micros(void);
+// free running clock in HAL_TICKS_PER_US ticks (the Timer1 timebase)
+#define HAL_TICKS_PER_US		2
+uint32_t hal_ticks(void);
+// monotonic millisecond clock
+uint32_t hal_millis(void);
+// cpu time for benchmarks: cycles on the AVR, nanoseconds of cpu time on the host
+uint32_t hal_cpu_ticks(void);
+
+#endif /* HAL_H_ */
@@ -0,0 +1,40 @@
+/*
+ * hal_avr.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * AVR side of hal.h, delays and the clock run on the Timer1 timebase
+ */
+#ifndef HAL_HOST
+
+#include "global.h"
+#include "timer.h"
+#include "hal.h"
+
+void hal_delay_ms(uint16_t ms)
+{
+	timerPause(ms);
+}
+
+uint32_t hal_ticks(void)
+{
+	return timer1GetTicks();
+}
+
+uint32_t hal_millis(void)
+{
+	return timer1GetMillis();
+}
+
+uint32_t hal_micros(void)
+{
+	return timer1GetTicks() / TIMER1_TICKS_PER_US;
+}
+
+uint32_t hal_cpu_ticks(void)
+{
+	// the core busy waits, elapsed cycles are cpu cycles
+	return timer1GetTicks() * (F_CPU / 1000000 / TIMER1_TICKS_PER_US);
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * health.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Device health records and quarantine, see health.h
+ */
+#include <string.h>
+#include "global.h"
+#include "hal.h"
+#include "onewire.h"
+#include "health.h"
+
+uint8_t HealthSkipAfter = 3;
+uint8_t HealthSkipMax   = 32;
+
+static Health_t Health[THERM_REGISTRY_SIZE];
+
+Health_t *healthGet(uint8_t slot)
+{
+	Health_t *h = &Health[slot];
+	uint8_t rom = therm_get_devID()[7];
+
+	// a different device in the slot, see health.h
+	if (h->rom != rom)
+	{
+		memset(h, 0, sizeof(Health_t));
+		h->rom = rom;
+	}
+	return h;
+}
+
+uint8_t healthQuarantined(Health_t *h)
+{
+	return HealthSkipAfter && h->fails >= HealthSkipAfter;
+}
+
+void healthUpdate(uint8_t slot, uint8_t ok)
+{
+	Health_t *h = healthGet(slot);
+	uint8_t n;
+
+	// r - r/16 + 15 stays below 256 and settles at 255 when every read fails
+	h->rate -= h->rate >> 4;
+	if (ok)
+	{
+		h->fails     = 0;
+		h->skip      = 0;
+		h->last_good = hal_millis();
+		return;
+	}
+	h->rate += 15;
+	if (h->fails < 0xff)
+		h->fails++;
+	// quarantined: sit out 2^(fails - HealthSkipAfter) sweeps
+	if (healthQuarantined(h))
+	{
+		n = h->fails - HealthSkipAfter;
+		h->skip = (n >= 8 || (1 << n) > HealthSkipMax) ? HealthSkipMax : 1 << n;
+	}
+}
+
+uint8_t healthDue(uint8_t slot)
+{
+	Health_t *h = healthGet(slot);
+
+	if (h->skip)
+	{
+		h->skip--;
+		return 0;
+	}
+	return 1;
+}
+
+void healthForget(uint8_t slot)
+{
+	if (slot < THERM_REGISTRY_SIZE)
+		memset(&Health[slot], 0, sizeof(Health_t));
+}
+
+void healthClear(void)
+{
+	memset(Health, 0, sizeof(Health));
+}
@@ -0,0 +1,52 @@
+/*
+ * health.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Device health records and quarantine for the registry slots of the
+ * current pin. Every temperature read of a slot updates its record:
+ * consecutive failures, the time of the last good read and an error rate
+ * (failure EMA, 1/16 per read). After HealthSkipAfter failures in a row
+ * the device is quarantined: the stream backs off and lets it sit out its
+ * next 1, 2, 4 ... sweeps, at most HealthSkipMax, instead of paying its
+ * retries in every sweep. The first good read puts it back in service.
+ * Records are kept per registry slot, not per ROM: a full ROM per record
+ * costs 140 bytes of RAM. Every registry write (save, search) starts the
+ * record of the slot over with healthForget(), so a record belongs to the
+ * device in its slot. As a backstop the record is tagged with the ROM CRC
+ * byte, which only tells apart devices with different CRC bytes (255 in
+ * 256) when the registry changes behind the firmware's back.
+ */
+
+#ifndef HEALTH_H_
+#define HEALTH_H_
+
+#include "global.h"
+
+typedef struct
+{
+	uint8_t  rom;		// CRC byte of the ROM the record belongs to
+	uint8_t  fails;		// failed reads in a row
+	uint8_t  rate;		// error rate, failures per 256 reads
+	uint8_t  skip;		// quarantined: sweeps to sit out before the next read
+	uint32_t last_good;	// hal_millis() of the last good read, 0 = never
+} Health_t;
+
+// failures in a row that quarantine a device (0 = never), longest backoff
+// in sweeps
+extern uint8_t HealthSkipAfter;
+extern uint8_t HealthSkipMax;
+
+// record of the slot whose ROM is loaded (therm_load_devID)
+Health_t *healthGet(uint8_t slot);
+uint8_t   healthQuarantined(Health_t *h);
+// counts a read of the loaded slot
+void      healthUpdate(uint8_t slot, uint8_t ok);
+// 1 when the loaded slot is read in this sweep, counts down the backoff
+uint8_t   healthDue(uint8_t slot);
+// forgets the record of a slot that gets a new device
+void      healthForget(uint8_t slot);
+// forgets every record
+void      healthClear(void);
+
+#endif /* HEALTH_H_ */
@@ -0,0 +1,119 @@
+/*
+ * hal_host.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Linux host implementation of hal.h, see hal_host.h
+ */
+#ifdef HAL_HOST
+
+#include <time.h>
+#include "global.h"
+#include "hal.h"
+
+// one delay loop is 4 cpu cycles
+#define HAL_HOST_NS_PER_LOOP	(4000000000ULL/F_CPU)
+// a pin access costs about 2 cpu cycles on the target
+#define HAL_HOST_NS_PER_IO		(2000000000ULL/F_CPU)
+
+static uint64_t HalHostTime;
+static uint8_t  HalHostIrq = 1;
+static uint8_t  HalHostDriven;
+static const HalHostBus *HalHostBusModel;
+
+void hal_host_irq_off(void)
+{
+	HalHostIrq = 0;
+}
+
+void hal_host_irq_on(void)
+{
+	HalHostIrq = 1;
+}
+
+hal_irq_t hal_irq_save(void)
+{
+	hal_irq_t state = HalHostIrq;
+	HalHostIrq = 0;
+	return state;
+}
+
+void hal_irq_restore(hal_irq_t state)
+{
+	HalHostIrq = state;
+}
+
+void hal_host_attach_bus(const HalHostBus *bus)
+{
+	HalHostBusModel = bus;
+}
+
+uint64_t hal_host_time_ns(void)
+{
+	return HalHostTime;
+}
+
+void hal_host_advance_ns(uint64_t ns)
+{
+	HalHostTime += ns;
+}
+
+void hal_bus_low(uint8_t bit)
+{
+	HalHostTime += HAL_HOST_NS_PER_IO;
+	HalHostDriven |= (1<<bit);
+	if (HalHostBusModel)
+		HalHostBusModel->drive(bit, 1, HalHostTime);
+}
+
+void hal_bus_release(uint8_t bit)
+{
+	HalHostTime += HAL_HOST_NS_PER_IO;
+	HalHostDriven &= ~(1<<bit);
+	if (HalHostBusModel)
+		HalHostBusModel->drive(bit, 0, HalHostTime);
+}
+
+uint8_t hal_bus_read(uint8_t bit)
+{
+	HalHostTime += HAL_HOST_NS_PER_IO;
+	if (HalHostDriven & (1<<bit))
+		return 0;
+	if (HalHostBusModel)
+		return HalHostBusModel->sample(bit, HalHostTime);
+	return 1;	// pull-up
+}
+
+void hal_delay_loops(uint16_t loops)
+{
+	HalHostTime += loops*HAL_HOST_NS_PER_LOOP;
+}
+
+void hal_delay_ms(uint16_t ms)
+{
+	HalHostTime += ms*1000000ULL;
+}
+
+uint32_t hal_ticks(void)
+{
+	return (uint32_t)(HalHostTime / (1000 / HAL_TICKS_PER_US));
+}
+
+uint32_t hal_millis(void)
+{
+	return (uint32_t)(HalHostTime/1000000);
+}
+
+uint32_t hal_micros(void)
+{
+	return (uint32_t)(HalHostTime/1000);
+}
+
+uint32_t hal_cpu_ticks(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint32_t)(ts.tv_sec*1000000000ULL + ts.tv_nsec);
+}
+
+#endif
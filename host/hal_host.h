@@ -0,0 +1,86 @@
+/*
+ * hal_host.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Linux host side of hal.h, selected with -DHAL_HOST.
+ * Time is virtual: delays advance a nanosecond clock instead of sleeping,
+ * so the core runs at full host speed while the bus still sees the exact
+ * slot timing. The 1-Wire bus is a pluggable model (HalHostBus); without
+ * one attached the line simply follows the pull-up.
+ * EEPROM and program memory variables are ordinary RAM.
+ */
+
+#ifndef HAL_HOST_H_
+#define HAL_HOST_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+// program memory
+#define PROGMEM
+#define PSTR(s)					(s)
+#define pgm_read_byte(addr)		(*(const uint8_t *)(addr))
+#define pgm_read_word(addr)		(*(const uint16_t *)(addr))
+#define strncmp_P				strncmp
+#define strcmp_P				strcmp
+#define strcpy_P				strcpy
+#define memcpy_P				memcpy
+
+// eeprom
+#define EEMEM
+#define eeprom_read_byte(addr)			(*(const uint8_t *)(addr))
+#define eeprom_read_word(addr)			(*(const uint16_t *)(addr))
+#define eeprom_read_dword(addr)			(*(const uint32_t *)(addr))
+#define eeprom_read_block(dst, src, n)	memcpy((dst), (src), (n))
+#define eeprom_write_byte(addr, val)	(*(uint8_t *)(addr) = (val))
+#define eeprom_write_word(addr, val)	(*(uint16_t *)(addr) = (val))
+#define eeprom_write_dword(addr, val)	(*(uint32_t *)(addr) = (val))
+#define eeprom_write_block(src, dst, n)	memcpy((dst), (src), (n))
+
+#ifndef _BV
+#define _BV(bit)				(1<<(bit))
+#endif
+
+// interrupts: the host core is single threaded, only nesting is tracked
+#define cli()					hal_host_irq_off()
+#define sei()					hal_host_irq_on()
+
+typedef uint8_t hal_irq_t;
+void      hal_host_irq_off(void);
+void      hal_host_irq_on(void);
+hal_irq_t hal_irq_save(void);
+void      hal_irq_restore(hal_irq_t state);
+
+// 1-Wire bus model, every call carries the virtual time in ns
+typedef struct
+{
+	void    (*drive)(uint8_t bit, uint8_t low, uint64_t t_ns);	// master drives low/releases
+	uint8_t (*sample)(uint8_t bit, uint64_t t_ns);				// line level, 0 = low
+} HalHostBus;
+
+void     hal_host_attach_bus(const HalHostBus *bus);
+uint64_t hal_host_time_ns(void);
+void     hal_host_advance_ns(uint64_t ns);
+
+void     hal_bus_low(uint8_t bit);
+void     hal_bus_release(uint8_t bit);
+uint8_t  hal_bus_read(uint8_t bit);
+
+#define HAL_BUS_LOW(bit)		hal_bus_low(bit)
+#define HAL_BUS_RELEASE(bit)	hal_bus_release(bit)
+#define HAL_BUS_READ(bit)		hal_bus_read(bit)
+
+// no trigger pins on the host
+#define HAL_TRIG_LOW(bit)
+#define HAL_TRIG_HIGH(bit)
+
+void     hal_delay_loops(uint16_t loops);
+
+#define HAL_TICKS16()			((uint16_t) hal_ticks())
+
+#endif /* HAL_HOST_H_ */
@@ -0,0 +1,106 @@
+/*
+ * owbench.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host benchmark suite: runs bench.c on the simulated bus for a range of
+ * device counts and prints one JSON line per result, e.g.
+ *
+ *   {"bench":"search","n":32,"bus_us":...,"cpu_ns":...,"out":...,"count":32}
+ *
+ * bus_us is virtual bus time and is exact; compare it against a saved
+ * baseline (make bench > baseline.json) after every change to onewire.c.
+ * cpu_ns is host cpu time and only meaningful relative to the same machine.
+ *
+ *   owbench [n ...]    device counts, default 1 8 32 128
+ */
+#ifdef HAL_HOST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "global.h"
+#include "hal.h"
+#include "rprintf.h"
+#include "onewire.h"
+#include "bench.h"
+#include "owsim.h"
+
+#define CRC_LOOPS 10000
+
+static uint8_t Roms[OWSIM_MAX_DEVICES][8];
+
+static void HostPutc(unsigned char c)
+{
+	putchar(c);
+}
+
+static void report(const char *name, uint16_t n, BenchResult_t *r)
+{
+	printf("{\"bench\":\"%s\",\"n\":%u,\"bus_us\":%lu,\"cpu_ns\":%lu,\"out\":%u,\"count\":%u}\n",
+			name, n, (unsigned long) r->bus_us, (unsigned long) r->cpu, r->out, r->count);
+}
+
+static void bench_devices(uint16_t n)
+{
+	BenchResult_t r;
+	uint16_t i;
+	int dev;
+
+	owsim_init(n);
+	for (i = 0; i < n; i++)
+	{
+		dev = owsim_add(0, DS18B20);
+		owsim_set_temp(dev, (int16_t)(i * 3 - 160));
+		owsim_get_rom(dev, Roms[i]);
+	}
+	therm_set_pin(0);
+
+	benchSearch(&r);
+	report("search", n, &r);
+
+	// sweep after a finished conversion, so real values are read
+	therm_reset();
+	therm_start_measurement();
+	hal_delay_ms(750);
+	benchSweep(&r, Roms, n);
+	report("sweep", n, &r);
+}
+
+int main(int argc, char **argv)
+{
+	static const uint16_t sizes[] = {1, 8, 32, 128};
+	BenchResult_t r;
+	uint16_t n;
+	int i;
+
+	rprintfInit(HostPutc);
+	benchInit(HostPutc);
+	therm_init();
+
+	if (argc > 1)
+		for (i = 1; i < argc; i++)
+		{
+			n = (uint16_t) atoi(argv[i]);
+			if (n > 0 && n <= OWSIM_MAX_DEVICES)
+				bench_devices(n);
+		}
+	else
+		for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+			bench_devices(sizes[i]);
+
+	owsim_init(1);
+	owsim_add(0, DS18B20);
+	benchReadRom(&r);
+	report("readrom", 1, &r);
+
+	owsim_init(1);
+	owsim_add(0, DS2438);
+	benchPage(&r);
+	report("page", 1, &r);
+
+	benchCrc(&r, CRC_LOOPS);
+	report("crc", 1, &r);
+	return 0;
+}
+
+#endif
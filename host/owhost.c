@@ -0,0 +1,279 @@
+/*
+ * owhost.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host command line for the firmware core: stdin/stdout take the place of
+ * the UART and the 1-Wire bus runs on virtual time (hal_host.c) with the
+ * simulated slaves of owsim.c.
+ *
+ *   make -C host && printf 'sim 5 40\nsearch\nconvert 750\ntemp\n' | host/owhost
+ *
+ * The stream tasks (stream.c) run on the same virtual time, between the
+ * command lines, for as long as "run" asks:
+ *
+ *   printf 'sim 3\nsearch\nstream 1\nrun 3000\n' | host/owhost
+ */
+#ifdef HAL_HOST
+
+#include <stdio.h>
+#include "global.h"
+#include "hal.h"
+#include "rprintf.h"
+#include "cmdline.h"
+#include "onewire.h"
+#include "sched.h"
+#include "stream.h"
+#include "health.h"
+#include "owsim.h"
+#include "trace.h"
+
+// registry slots per pin, as in main.h
+#define HOST_NUM_DEVICES 20
+
+// virtual time of the next scheduler tick (Timer0 overflow) and of the
+// end of the pending "run"
+static uint64_t HostTickNs = SCHED_TICK_US * 1000ULL, HostRunNs;
+
+static void HostPutc(unsigned char c)
+{
+	putchar(c);
+}
+
+static void HostReset(void)
+{
+	rprintf("%d", therm_reset());
+	cmdlinePrintPromptEnd();
+}
+
+static void HostReadRom(void)
+{
+	rprintf("%d ", therm_read_devID());
+	therm_print_devID();
+	cmdlinePrintPromptEnd();
+}
+
+static void HostTiming(void)
+{
+	therm_print_timing((uint8_t) cmdlineGetArgInt(1));
+	cmdlinePrintPromptEnd();
+}
+
+static void HostTime(void)
+{
+	// virtual microseconds since start (rprintf has no 32 bit format)
+	printf("%lu", (unsigned long) hal_micros());
+	cmdlinePrintPromptEnd();
+}
+
+// sim [count] [family] [t16]: add simulated slaves to the current pin
+static void HostSim(void)
+{
+	uint16_t n      = (uint16_t) cmdlineGetArgInt(1);
+	uint8_t  family = (uint8_t)  cmdlineGetArgInt(2);
+	int16_t  t16    = (int16_t)  cmdlineGetArgInt(3);
+	int dev = -1;
+
+	if (family == 0)
+		family = DS18B20;
+	while (n--)
+	{
+		dev = owsim_add(therm_get_pin(), family);
+		if (dev < 0)
+			break;
+		if (t16)
+			owsim_set_temp(dev, t16);
+		// spread the voltages of DS2438s, 3.00 V upwards
+		owsim_set_voltage(dev, 300 + dev);
+	}
+	rprintf("%d", owsim_count());
+	cmdlinePrintPromptEnd();
+}
+
+// noise [ppm] [presence loss per mille]
+static void HostNoise(void)
+{
+	owsim_set_noise((uint32_t) cmdlineGetArgInt(1));
+	owsim_set_presence_loss((uint16_t) cmdlineGetArgInt(2));
+	cmdlinePrintPromptEnd();
+}
+
+// search the current pin and store the first ROMs in the registry, as OneSearch
+static void HostSearch(void)
+{
+	uint16_t found = 0;
+
+	therm_search_init();
+	if (OWFirst())
+	{
+		do
+		{
+			if (found < HOST_NUM_DEVICES)
+			{
+				therm_save_devID(found);
+				healthForget(found);
+			}
+			found++;
+		}
+		while (OWNext());
+	}
+	printf("%u", found);
+	cmdlinePrintPromptEnd();
+}
+
+// convert [ms]: broadcast a conversion and wait (default 750 ms)
+static void HostConvert(void)
+{
+	uint16_t ms = (uint16_t) cmdlineGetArgInt(1);
+
+	therm_reset();
+	therm_start_measurement();
+	hal_delay_ms(ms ? ms : 750);
+	rprintf("1");
+	cmdlinePrintPromptEnd();
+}
+
+// read every registered device of the current pin, as GetTemperature
+static void HostTemp(void)
+{
+	int16_t t[2];
+	uint8_t i;
+
+	rprintfCRLF();
+	for (i = 0; i < HOST_NUM_DEVICES; i++)
+	{
+		if (therm_load_devID(i) == 1)
+		{
+			therm_print_devID();
+			rprintfProgStrM(" : ");
+			therm_read_result(t);
+			rprintfProgStrM(" : ");
+			therm_print_scratchpad();
+			rprintfCRLF();
+		}
+	}
+	cmdlinePrintPromptEnd();
+}
+
+// speed [on] [slot] [od]: as the firmware command
+static void HostSpeed(void)
+{
+	therm_enable_overdrive((uint8_t) cmdlineGetArgInt(1));
+	if (cmdlineGetArgStr(2)[0])
+		therm_set_overdrive((uint8_t) cmdlineGetArgInt(2), (uint8_t) cmdlineGetArgInt(3));
+	rprintf("%d", (uint8_t) cmdlineGetArgInt(1) != 0);
+	cmdlinePrintPromptEnd();
+}
+
+static void HostStats(void)
+{
+	OwSimStats *s = owsim_stats();
+	printf("{\"resets\":%lu,\"slots\":%lu,\"presence\":%lu,\"flips\":%lu,\"od_slots\":%lu}",
+			s->resets, s->slots, s->presence, s->flips, s->od_slots);
+	cmdlinePrintPromptEnd();
+}
+
+// stream [mode] [deadband] [max silence]: as the firmware command
+static void HostStream(void)
+{
+	streamStart((uint8_t) cmdlineGetArgInt(1), (uint16_t) cmdlineGetArgInt(2),
+			(uint8_t) cmdlineGetArgInt(3));
+	rprintf("%d", Flags.stream_timer_0);
+	cmdlinePrintPromptEnd();
+}
+
+// interval [ticks]: scheduler ticks between stream conversions
+static void HostInterval(void)
+{
+	if (cmdlineGetArgStr(1)[0])
+		streamSetInterval((uint16_t) cmdlineGetArgInt(1));
+	rprintf("%d", streamGetInterval());
+	cmdlinePrintPromptEnd();
+}
+
+// run [ms]: lets the scheduler run for <ms> of virtual time once the
+// command line is done
+static void HostRun(void)
+{
+	HostRunNs = hal_host_time_ns() + (uint64_t) cmdlineGetArgInt(1) * 1000000;
+	cmdlinePrintPromptEnd();
+}
+
+// the main loop of the firmware: ticks every SCHED_TICK_US, due tasks in
+// between, idle time skipped
+static void HostRunSched(void)
+{
+	uint64_t now;
+
+	while ((now = hal_host_time_ns()) < HostRunNs)
+	{
+		while (now >= HostTickNs)
+		{
+			schedTick();
+			HostTickNs += SCHED_TICK_US * 1000ULL;
+		}
+		if (!schedRunOnce())
+			hal_host_advance_ns((HostTickNs < HostRunNs ? HostTickNs : HostRunNs) - now);
+	}
+}
+
+#ifdef THERM_TRACE
+// same format as the firmware "trace" command
+static void HostTrace(void)
+{
+	TraceRecord_t rec;
+	const char *sep = "";
+
+	printf("{\"trace\":[");
+	while (traceGet(&rec))
+	{
+		printf("%s[%u,%u,%u]", sep, rec.event, rec.data, rec.tick);
+		sep = ",";
+	}
+	printf("]}");
+	cmdlinePrintPromptEnd();
+}
+#endif
+
+int main(void)
+{
+	int c;
+
+	rprintfInit(HostPutc);
+	cmdlineInit();
+	cmdlineSetOutputFunc(HostPutc);
+	therm_init();
+	owsim_init(1);
+	streamInit(HostPutc);
+	streamSetInterval(SCHED_MS(1000));
+
+	cmdlineAddCommand((u08*) "reset",  HostReset);
+	cmdlineAddCommand((u08*) "rom",    HostReadRom);
+	cmdlineAddCommand((u08*) "timing", HostTiming);
+	cmdlineAddCommand((u08*) "time",   HostTime);
+	cmdlineAddCommand((u08*) "sim",    HostSim);
+	cmdlineAddCommand((u08*) "noise",  HostNoise);
+	cmdlineAddCommand((u08*) "search", HostSearch);
+	cmdlineAddCommand((u08*) "convert",HostConvert);
+	cmdlineAddCommand((u08*) "temp",   HostTemp);
+	cmdlineAddCommand((u08*) "simstats",HostStats);
+	cmdlineAddCommand((u08*) "speed",  HostSpeed);
+	cmdlineAddCommand((u08*) "stream", HostStream);
+	cmdlineAddCommand((u08*) "interval",HostInterval);
+	cmdlineAddCommand((u08*) "run",    HostRun);
+#ifdef THERM_TRACE
+	cmdlineAddCommand((u08*) "trace",  HostTrace);
+#endif
+
+	while ((c = getchar()) != EOF)
+	{
+		cmdlineInputFunc((unsigned char) c);
+		while (cmdlineIsBusy())
+			cmdlineMainLoop();
+		HostRunSched();
+	}
+	putchar('\n');
+	return 0;
+}
+
+#endif
@@ -0,0 +1,510 @@
+/*
+ * owsim.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Bit level 1-Wire bus simulator, see owsim.h
+ */
+#ifdef HAL_HOST
+
+#include <string.h>
+#include "global.h"
+#include "hal.h"
+#include "owsim.h"
+
+#define NS(us)					((uint64_t)(us)*1000ULL)
+#define OWSIM_RESET_MIN			NS(400)
+#define OWSIM_PRESENCE_FROM		NS(30)
+#define OWSIM_PRESENCE_TO		NS(150)
+#define OWSIM_READ_HOLD			NS(28)
+#define OWSIM_WRITE_SAMPLE		NS(30)
+// overdrive: read slot 0 held until 3 us, write slots sampled at 3 us
+#define OWSIM_OD_READ_HOLD		NS(3)
+#define OWSIM_OD_WRITE_SAMPLE	NS(3)
+
+#define FAMILY_DS18S20			0x10
+#define FAMILY_DS2438			0x26
+#define FAMILY_DS18B20			0x28
+#define FAMILY_DS28EA00			0x42	// DS18B20 scratchpad, overdrive capable
+
+// slave protocol states
+enum
+{
+	ST_IDLE,		// not selected, waits for a reset
+	ST_ROM_CMD,		// receiving the ROM command
+	ST_READ_ROM,	// sending the ROM ID
+	ST_MATCH,		// receiving a ROM ID to compare
+	ST_SEARCH,		// search: send bit, send complement, receive direction
+	ST_FUNC,		// receiving the function command
+	ST_ARG,			// receiving a DS2438 page number
+	ST_SEND,		// sending tx[], then 1s
+	ST_RECV,		// receiving scratchpad data
+	ST_CONVERT,		// read slots return 0 while converting
+};
+
+typedef struct
+{
+	uint8_t  pin;
+	uint8_t  rom[8];
+	int16_t  t16;			// current temperature, 1/16 C
+	uint16_t volt;			// DS2438 voltage, 10 mV
+	uint32_t conv_us;
+	uint8_t  conv_kind;		// conversion in progress: 0, 'T' or 'V'
+	uint64_t conv_done;
+	int16_t  result_t16;	// DS18x20 last converted temperature
+	uint8_t  th, tl, cfg;
+	uint8_t  page[8][8];	// DS2438 memory and scratchpad
+	uint8_t  sp[8];
+	// protocol
+	uint8_t  state, cmd, arg;
+	uint16_t pos;			// bit position of ROM or tx data
+	uint8_t  rx, rxbits;
+	uint8_t  tx[9], txlen;
+	uint8_t  wr;
+	uint8_t  slot_write;	// the current slot is received (sampled on release)
+	uint8_t  od;			// at overdrive speed until the next standard reset
+} OwSimDevice;
+
+typedef struct
+{
+	uint64_t fall;			// last falling edge of the master
+	uint64_t hold_from;		// slaves hold the line low in [hold_from, hold_to)
+	uint64_t hold_to;
+} OwSimPin;
+
+static OwSimDevice OwSimDev[OWSIM_MAX_DEVICES];
+static int         OwSimNumDev;
+static OwSimPin    OwSimPins[OWSIM_NUM_PINS];
+static OwSimStats  OwSimStat;
+static uint32_t    OwSimNoise;
+static uint16_t    OwSimPresenceLoss;
+static uint32_t    OwSimRand = 1;
+
+static uint32_t owsim_rand(void)
+{
+	// xorshift32
+	OwSimRand ^= OwSimRand << 13;
+	OwSimRand ^= OwSimRand >> 17;
+	OwSimRand ^= OwSimRand << 5;
+	return OwSimRand;
+}
+
+static uint8_t owsim_crc8(const uint8_t *data, uint8_t len)
+{
+	uint8_t crc = 0, i, b, mix;
+	while (len--)
+	{
+		b = *data++;
+		for (i = 0; i < 8; i++)
+		{
+			mix = (crc ^ b) & 1;
+			crc >>= 1;
+			if (mix)
+				crc ^= 0x8C;
+			b >>= 1;
+		}
+	}
+	return crc;
+}
+
+static uint32_t owsim_default_conv(uint8_t family)
+{
+	return (family == FAMILY_DS2438) ? 10000 : 750000;
+}
+
+// apply a finished conversion
+static void owsim_settle(OwSimDevice *d, uint64_t t)
+{
+	int16_t reg;
+	if (!d->conv_kind || t < d->conv_done)
+		return;
+	if (d->rom[0] != FAMILY_DS2438)
+		d->result_t16 = d->t16;
+	else if (d->conv_kind == 'T')
+	{
+		// 13 bit register, 1/32 C in bits 15..3
+		reg = (int16_t)(d->t16 << 4);
+		d->page[0][1] = reg & 0xFF;
+		d->page[0][2] = (reg >> 8) & 0xFF;
+	}
+	else
+	{
+		d->page[0][3] = d->volt & 0xFF;
+		d->page[0][4] = (d->volt >> 8) & 0x03;
+	}
+	d->conv_kind = 0;
+}
+
+static void owsim_start_conv(OwSimDevice *d, uint8_t kind, uint64_t t)
+{
+	d->conv_kind = kind;
+	d->conv_done = t + NS(d->conv_us);
+	d->state     = ST_CONVERT;
+}
+
+static void owsim_load_scratchpad(OwSimDevice *d, uint64_t t)
+{
+	int16_t raw, whole;
+
+	owsim_settle(d, t);
+	if (d->rom[0] == FAMILY_DS18S20)
+	{
+		// 0.5 C register plus COUNT_REMAIN for the 1/16 C fraction
+		whole = (int16_t)((d->result_t16 + 4) >> 4);
+		raw   = whole * 2;
+		d->tx[0] = raw & 0xFF;
+		d->tx[1] = (raw >> 8) & 0xFF;
+		d->tx[4] = 0xFF;
+		d->tx[6] = (uint8_t)(whole * 16 + 12 - d->result_t16);
+	}
+	else
+	{
+		// DS18B20 and DS28EA00
+		raw = d->result_t16;
+		d->tx[0] = raw & 0xFF;
+		d->tx[1] = (raw >> 8) & 0xFF;
+		d->tx[4] = d->cfg;
+		d->tx[6] = 0x0C;
+	}
+	d->tx[2] = d->th;
+	d->tx[3] = d->tl;
+	d->tx[5] = 0xFF;
+	d->tx[7] = 0x10;
+	d->tx[8] = owsim_crc8(d->tx, 8);
+	d->txlen = 9;
+	d->pos   = 0;
+	d->state = ST_SEND;
+}
+
+static void owsim_function(OwSimDevice *d, uint8_t cmd, uint64_t t)
+{
+	d->cmd = cmd;
+	if (d->rom[0] == FAMILY_DS2438)
+	{
+		switch (cmd)
+		{
+		case 0x44: owsim_start_conv(d, 'T', t); break;
+		case 0xB4: owsim_start_conv(d, 'V', t); break;
+		case 0xB8:
+		case 0xBE:
+		case 0x4E:
+		case 0x48: d->state = ST_ARG; break;
+		default:   d->state = ST_IDLE; break;
+		}
+		return;
+	}
+	switch (cmd)
+	{
+	case 0x44: owsim_start_conv(d, 'T', t); break;
+	case 0xBE: owsim_load_scratchpad(d, t); break;
+	case 0x4E: d->wr = 0; d->state = ST_RECV; break;
+	// read power supply: externally powered, answers 1s
+	case 0xB4: d->state = ST_CONVERT; break;
+	default:   d->state = ST_IDLE; break;
+	}
+}
+
+static void owsim_page_command(OwSimDevice *d, uint8_t page, uint64_t t)
+{
+	d->arg = page & 7;
+	owsim_settle(d, t);
+	switch (d->cmd)
+	{
+	case 0xB8:
+		memcpy(d->sp, d->page[d->arg], 8);
+		d->state = ST_IDLE;
+		break;
+	case 0xBE:
+		memcpy(d->tx, d->sp, 8);
+		d->tx[8] = owsim_crc8(d->tx, 8);
+		d->txlen = 9;
+		d->pos   = 0;
+		d->state = ST_SEND;
+		break;
+	case 0x4E:
+		d->wr    = 0;
+		d->state = ST_RECV;
+		break;
+	default: // 0x48 copy scratchpad
+		memcpy(d->page[d->arg], d->sp, 8);
+		d->state = ST_IDLE;
+		break;
+	}
+}
+
+static void owsim_byte(OwSimDevice *d, uint8_t b, uint64_t t)
+{
+	switch (d->state)
+	{
+	case ST_ROM_CMD:
+		d->pos = 0;
+		if (b == 0x33)
+			d->state = ST_READ_ROM;
+		else if (b == 0x55)
+			d->state = ST_MATCH;
+		else if (b == 0xCC)
+			d->state = ST_FUNC;
+		else if (b == 0xF0)
+			d->state = ST_SEARCH;
+		else if ((b == 0x69 || b == 0x3C) && d->rom[0] == FAMILY_DS28EA00)
+		{
+			// Overdrive Match/Skip ROM, the rest runs at overdrive speed
+			d->od    = 1;
+			d->state = (b == 0x69) ? ST_MATCH : ST_FUNC;
+		}
+		else
+			d->state = ST_IDLE;	// alarm search, overdrive on other families
+		break;
+	case ST_FUNC:
+		owsim_function(d, b, t);
+		break;
+	case ST_ARG:
+		owsim_page_command(d, b, t);
+		break;
+	case ST_RECV:
+		if (d->rom[0] == FAMILY_DS2438)
+			d->sp[d->wr++ & 7] = b;
+		else if (d->wr == 0)
+			d->th = b, d->wr++;
+		else if (d->wr == 1)
+			d->tl = b, d->wr++;
+		else if (d->wr == 2 && d->rom[0] != FAMILY_DS18S20)
+			d->cfg = b, d->wr++;
+		break;
+	}
+}
+
+static uint8_t owsim_rom_bit(OwSimDevice *d, uint16_t n)
+{
+	return (d->rom[n >> 3] >> (n & 7)) & 1;
+}
+
+// master falling edge: decide whether this slot is sent or received
+static void owsim_fall(OwSimDevice *d, OwSimPin *p, uint64_t t)
+{
+	uint8_t bit = 1;
+
+	d->slot_write = 0;
+	switch (d->state)
+	{
+	case ST_READ_ROM:
+		bit = owsim_rom_bit(d, d->pos);
+		if (++d->pos == 64)
+			d->state = ST_FUNC;
+		break;
+	case ST_SEARCH:
+		if (d->pos % 3 == 2)
+		{
+			d->slot_write = 1;
+			return;
+		}
+		bit = owsim_rom_bit(d, d->pos / 3) ^ (d->pos % 3);
+		d->pos++;
+		break;
+	case ST_SEND:
+		if (d->pos < d->txlen * 8)
+		{
+			bit = (d->tx[d->pos >> 3] >> (d->pos & 7)) & 1;
+			d->pos++;
+		}
+		break;
+	case ST_CONVERT:
+		owsim_settle(d, t);
+		bit = (d->conv_kind == 0);
+		break;
+	case ST_IDLE:
+		return;
+	default:
+		d->slot_write = 1;
+		return;
+	}
+	if (!bit)
+	{
+		uint64_t hold = d->od ? OWSIM_OD_READ_HOLD : OWSIM_READ_HOLD;
+		p->hold_from = t;
+		if (p->hold_to < t + hold)
+			p->hold_to = t + hold;
+	}
+}
+
+// master releases a received slot
+static void owsim_write(OwSimDevice *d, uint8_t bit, uint64_t t)
+{
+	switch (d->state)
+	{
+	case ST_MATCH:
+		if (bit != owsim_rom_bit(d, d->pos))
+			d->state = ST_IDLE;
+		else if (++d->pos == 64)
+			d->state = ST_FUNC;
+		return;
+	case ST_SEARCH:
+		if (bit != owsim_rom_bit(d, d->pos / 3))
+			d->state = ST_IDLE;
+		else if (++d->pos == 64 * 3)
+			d->state = ST_FUNC;
+		return;
+	}
+	d->rx = (d->rx >> 1) | (bit << 7);
+	if (++d->rxbits == 8)
+	{
+		d->rxbits = 0;
+		owsim_byte(d, d->rx, t);
+	}
+}
+
+static void owsim_drive(uint8_t pin, uint8_t low, uint64_t t)
+{
+	OwSimPin *p = &OwSimPins[pin & (OWSIM_NUM_PINS - 1)];
+	uint64_t width;
+	uint8_t present = 0, bit;
+	int i;
+
+	if (low)
+	{
+		p->fall      = t;
+		p->hold_from = 0;
+		p->hold_to   = 0;
+		for (i = 0; i < OwSimNumDev; i++)
+			if (OwSimDev[i].pin == pin)
+				owsim_fall(&OwSimDev[i], p, t);
+		return;
+	}
+
+	width = t - p->fall;
+	if (width >= OWSIM_RESET_MIN)
+	{
+		OwSimStat.resets++;
+		for (i = 0; i < OwSimNumDev; i++)
+		{
+			OwSimDevice *d = &OwSimDev[i];
+			if (d->pin != pin)
+				continue;
+			d->state  = ST_ROM_CMD;
+			d->rxbits = 0;
+			d->od     = 0;
+			if (OwSimPresenceLoss && (owsim_rand() % 1000) < OwSimPresenceLoss)
+				continue;
+			present = 1;
+			OwSimStat.presence++;
+		}
+		if (present)
+		{
+			p->hold_from = t + OWSIM_PRESENCE_FROM;
+			p->hold_to   = t + OWSIM_PRESENCE_TO;
+		}
+		return;
+	}
+
+	// the slaves sample 30 us into the slot (3 us at overdrive)
+	OwSimStat.slots++;
+	for (i = 0; i < OwSimNumDev; i++)
+		if (OwSimDev[i].pin == pin && OwSimDev[i].slot_write)
+		{
+			OwSimDevice *d = &OwSimDev[i];
+			if (d->od)
+				OwSimStat.od_slots++;
+			bit = (width < (d->od ? OWSIM_OD_WRITE_SAMPLE : OWSIM_WRITE_SAMPLE));
+			d->slot_write = 0;
+			owsim_write(d, bit, t);
+		}
+}
+
+static uint8_t owsim_sample(uint8_t pin, uint64_t t)
+{
+	OwSimPin *p = &OwSimPins[pin & (OWSIM_NUM_PINS - 1)];
+	uint8_t level = !(t >= p->hold_from && t < p->hold_to);
+
+	if (OwSimNoise && (owsim_rand() % 1000000) < OwSimNoise)
+	{
+		OwSimStat.flips++;
+		level ^= 1;
+	}
+	return level;
+}
+
+static const HalHostBus OwSimBus = { owsim_drive, owsim_sample };
+
+void owsim_init(uint32_t seed)
+{
+	memset(OwSimDev, 0, sizeof(OwSimDev));
+	memset(OwSimPins, 0, sizeof(OwSimPins));
+	memset(&OwSimStat, 0, sizeof(OwSimStat));
+	OwSimNumDev       = 0;
+	OwSimNoise        = 0;
+	OwSimPresenceLoss = 0;
+	OwSimRand         = seed ? seed : 1;
+	hal_host_attach_bus(&OwSimBus);
+}
+
+int owsim_add_serial(uint8_t pin, uint8_t family, uint64_t serial)
+{
+	OwSimDevice *d;
+	uint8_t i;
+
+	if (OwSimNumDev == OWSIM_MAX_DEVICES || pin >= OWSIM_NUM_PINS)
+		return -1;
+	d = &OwSimDev[OwSimNumDev];
+	memset(d, 0, sizeof(*d));
+	d->pin    = pin;
+	d->rom[0] = family;
+	for (i = 1; i < 7; i++)
+		d->rom[i] = (serial >> (8 * (i - 1))) & 0xFF;
+	d->rom[7]     = owsim_crc8(d->rom, 7);
+	d->t16        = 21 * 16;
+	d->result_t16 = 85 * 16;	// power up value
+	d->th         = 0x4B;
+	d->tl         = 0x46;
+	d->cfg        = 0x7F;
+	d->conv_us    = owsim_default_conv(family);
+	d->state      = ST_IDLE;
+	return OwSimNumDev++;
+}
+
+int owsim_add(uint8_t pin, uint8_t family)
+{
+	uint64_t serial = ((uint64_t) owsim_rand() << 16) ^ owsim_rand();
+	return owsim_add_serial(pin, family, serial & 0xFFFFFFFFFFFFULL);
+}
+
+int owsim_count(void)
+{
+	return OwSimNumDev;
+}
+
+void owsim_get_rom(int dev, uint8_t *rom)
+{
+	memcpy(rom, OwSimDev[dev].rom, 8);
+}
+
+void owsim_set_temp(int dev, int16_t t16)
+{
+	OwSimDev[dev].t16 = t16;
+}
+
+void owsim_set_voltage(int dev, uint16_t v10mv)
+{
+	OwSimDev[dev].volt = v10mv;
+}
+
+void owsim_set_conv_time(int dev, uint32_t us)
+{
+	OwSimDev[dev].conv_us = us ? us : owsim_default_conv(OwSimDev[dev].rom[0]);
+}
+
+void owsim_set_noise(uint32_t ppm)
+{
+	OwSimNoise = ppm;
+}
+
+void owsim_set_presence_loss(uint16_t per_mille)
+{
+	OwSimPresenceLoss = per_mille;
+}
+
+OwSimStats *owsim_stats(void)
+{
+	return &OwSimStat;
+}
+
+#endif
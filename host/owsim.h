@@ -0,0 +1,62 @@
+/*
+ * owsim.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Bit level 1-Wire bus simulator for the host build.
+ * Virtual slaves watch the master's edges through the hal_host bus hooks
+ * and answer at the slot level: presence pulses, ROM commands (read, match,
+ * skip, search; Overdrive Match/Skip ROM on the DS28EA00), DS18B20, DS18S20
+ * and DS28EA00 scratchpads and conversions, DS2438 pages (recall, read,
+ * write, copy) and T/V conversions. Scratchpads and ROM
+ * IDs carry correct CRCs. Conversions take their datasheet time on the
+ * virtual clock; reading early returns the previous result (85 C at
+ * power up). Noise flips sampled bits and presence pulses can be dropped.
+ *
+ * Slave timing (from the falling edge or end of reset):
+ *  presence low 30..150 us after reset release, master reset >= 400 us
+ *  read slot: a 0 is held low until 28 us after the falling edge
+ *  write slot: the slave samples 30 us after the falling edge
+ *  at overdrive speed (until the next reset) both are 3 us
+ */
+
+#ifndef OWSIM_H_
+#define OWSIM_H_
+
+#include <stdint.h>
+
+#define OWSIM_MAX_DEVICES	512
+#define OWSIM_NUM_PINS		4
+
+typedef struct
+{
+	unsigned long resets;		// reset pulses seen
+	unsigned long slots;		// time slots seen
+	unsigned long presence;		// presence pulses sent (all slaves)
+	unsigned long flips;		// samples inverted by noise
+	unsigned long od_slots;		// write slots received at overdrive speed
+} OwSimStats;
+
+// clear all slaves and statistics, attach to the host HAL
+void owsim_init(uint32_t seed);
+// add a slave, the serial number is random; returns its index or -1
+int  owsim_add(uint8_t pin, uint8_t family);
+// add a slave with a given 48 bit serial number
+int  owsim_add_serial(uint8_t pin, uint8_t family, uint64_t serial);
+int  owsim_count(void);
+
+void owsim_get_rom(int dev, uint8_t *rom);
+// temperature in 1/16 C, DS2438 voltage in 10 mV
+void owsim_set_temp(int dev, int16_t t16);
+void owsim_set_voltage(int dev, uint16_t v10mv);
+// conversion time in us, 0 restores the datasheet value
+void owsim_set_conv_time(int dev, uint32_t us);
+
+// probability per million that a sampled bit is inverted
+void owsim_set_noise(uint32_t ppm);
+// probability per thousand that a slave misses its presence pulse
+void owsim_set_presence_loss(uint16_t per_mille);
+
+OwSimStats *owsim_stats(void);
+
+#endif /* OWSIM_H_ */
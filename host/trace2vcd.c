@@ -0,0 +1,125 @@
+/*
+ * trace2vcd.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Renders the output of the "trace" command (trace.h) as a VCD file for a
+ * waveform viewer such as GTKWave:
+ *
+ *   trace2vcd < trace.json > trace.vcd
+ *
+ * Signals: reset (bus held low by a reset), presence (a device answered),
+ * sample/strobe (read slot value, strobe toggles on every sample),
+ * read/write (last byte), crc_ok and pin.
+ * Record times are the low word of the 0.5 us timebase; EPOCH records
+ * (one per reset) supply the high word, later wraps are counted in between.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "trace.h"
+
+#define TIMESCALE_NS	100
+#define TICK_UNITS		5		// 0.5 us ticks in TIMESCALE_NS units
+
+static char Input[1 << 16];
+
+static void bits(uint8_t value, uint8_t width, char id)
+{
+	int i;
+	putchar('b');
+	for (i = width - 1; i >= 0; i--)
+		putchar((value >> i) & 1 ? '1' : '0');
+	printf(" %c\n", id);
+}
+
+int main(void)
+{
+	size_t len = fread(Input, 1, sizeof(Input) - 1, stdin);
+	char *p, *end;
+	long v[3];
+	int n = 0, strobe = 0, records = 0;
+	uint32_t high = 0;
+	uint16_t prev = 0;
+	uint64_t t, last = 0;
+
+	Input[len] = 0;
+	p = strstr(Input, "\"trace\"");
+	if (p == NULL)
+	{
+		fprintf(stderr, "trace2vcd: no \"trace\" record on stdin\n");
+		return 1;
+	}
+
+	printf("$timescale %d ns $end\n", TIMESCALE_NS);
+	printf("$scope module onewire $end\n");
+	printf("$var wire 1 r reset $end\n");
+	printf("$var wire 1 p presence $end\n");
+	printf("$var wire 1 s sample $end\n");
+	printf("$var wire 1 t strobe $end\n");
+	printf("$var wire 8 R read $end\n");
+	printf("$var wire 8 W write $end\n");
+	printf("$var wire 1 c crc_ok $end\n");
+	printf("$var wire 2 P pin $end\n");
+	printf("$upscope $end\n$enddefinitions $end\n");
+	printf("#0\n$dumpvars\n0r\n0p\n0s\n0t\nbx R\nbx W\nxc\nb00 P\n$end\n");
+
+	// the dump only holds numbers inside the trace array
+	for (p += 7; *p && *p != '}'; )
+	{
+		if (*p < '0' || *p > '9')
+		{
+			p++;
+			continue;
+		}
+		v[n++] = strtol(p, &end, 10);
+		p = end;
+		if (n < 3)
+			continue;
+		n = 0;
+		records++;
+
+		if (v[0] == TRACE_EV_EPOCH)
+		{
+			high = (uint32_t) v[2] << 16;
+			prev = (uint16_t)(v[1] << 8);
+			continue;
+		}
+		if ((uint16_t) v[2] < prev)
+			high += 0x10000;
+		prev = (uint16_t) v[2];
+		t = (uint64_t)(high | prev) * TICK_UNITS;
+		// records nested from an interrupt may be slightly out of order
+		if (t < last)
+			t = last;
+		last = t;
+		printf("#%llu\n", (unsigned long long) t);
+
+		switch (v[0])
+		{
+		case TRACE_EV_RESET:
+			printf("1r\n0p\n");
+			bits((uint8_t) v[1], 2, 'P');
+			break;
+		case TRACE_EV_PRESENCE:
+			printf("0r\n%cp\n", v[1] ? '0' : '1');
+			break;
+		case TRACE_EV_SAMPLE:
+			strobe ^= 1;
+			printf("%lds\n%dt\n", v[1] & 1, strobe);
+			break;
+		case TRACE_EV_READ:
+			bits((uint8_t) v[1], 8, 'R');
+			break;
+		case TRACE_EV_WRITE:
+			bits((uint8_t) v[1], 8, 'W');
+			break;
+		case TRACE_EV_CRC:
+			printf("%dc\n", v[1] ? 1 : 0);
+			break;
+		}
+	}
+	fprintf(stderr, "trace2vcd: %d records\n", records);
+	return 0;
+}
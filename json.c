@@ -0,0 +1,134 @@
+/*
+ * json.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Streaming JSON writer, see json.h
+ */
+#include "global.h"
+#include "rprintf.h"
+#include "json.h"
+
+// writer state
+// -JsonDepth is the current nesting level
+// -bit n of JsonHasItems is set once level n holds an element
+static uint8_t JsonDepth;
+static uint8_t JsonHasItems;
+
+void jsonBegin(void)
+{
+	JsonDepth = 0;
+	JsonHasItems = 0;
+}
+
+void jsonValue(void)
+{
+	// separate from the previous element at this level
+	if (JsonHasItems & BV(JsonDepth))
+		rprintfChar(',');
+	JsonHasItems |= BV(JsonDepth);
+}
+
+static void jsonOpen(char c)
+{
+	jsonValue();
+	rprintfChar(c);
+	if (JsonDepth < JSON_MAX_DEPTH-1)
+		JsonDepth++;
+	JsonHasItems &= ~BV(JsonDepth);
+}
+
+static void jsonClose(char c)
+{
+	rprintfChar(c);
+	if (JsonDepth)
+		JsonDepth--;
+}
+
+void jsonOpenArray(void)
+{
+	jsonOpen('[');
+}
+
+void jsonCloseArray(void)
+{
+	jsonClose(']');
+}
+
+void jsonOpenObject(void)
+{
+	jsonOpen('{');
+}
+
+void jsonCloseObject(void)
+{
+	jsonClose('}');
+}
+
+void jsonKey(const char* key)
+{
+	jsonValue();
+	rprintfChar('"');
+	rprintfProgStr(key);
+	rprintfProgStrM("\":");
+	// the value that follows is not a new element
+	JsonHasItems &= ~BV(JsonDepth);
+}
+
+void jsonUInt(uint16_t n)
+{
+	jsonValue();
+	rprintfDecU16(n, 0, 0);
+}
+
+void jsonULong(uint32_t n)
+{
+	jsonValue();
+	// print in groups of four digits, rprintf has no 32 bit conversion
+	if (n >= 100000000UL)
+	{
+		rprintfDecU16(n / 100000000UL, 0, 0);
+		rprintfDecU16((n / 10000) % 10000, 4, '0');
+		rprintfDecU16(n % 10000, 4, '0');
+	}
+	else if (n >= 10000)
+	{
+		rprintfDecU16(n / 10000, 0, 0);
+		rprintfDecU16(n % 10000, 4, '0');
+	}
+	else
+		rprintfDecU16(n, 0, 0);
+}
+
+void jsonInt(int16_t n)
+{
+	jsonValue();
+	if (n < 0)
+	{
+		rprintfChar('-');
+		n = -n;
+	}
+	rprintfDecU16((uint16_t) n, 0, 0);
+}
+
+void jsonStr(char* str)
+{
+	jsonValue();
+	rprintfChar('"');
+	rprintfStr(str);
+	rprintfChar('"');
+}
+
+void jsonStrP(const char* str)
+{
+	jsonValue();
+	rprintfChar('"');
+	rprintfProgStr(str);
+	rprintfChar('"');
+}
+
+void jsonNull(void)
+{
+	jsonValue();
+	rprintfProgStrM("null");
+}
@@ -0,0 +1,54 @@
+/*
+ * json.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Streaming JSON writer.
+ * Output goes straight to rprintf, nothing is buffered: the writer only keeps
+ * the nesting depth and whether each level already holds an element, so that
+ * separators are inserted automatically and the output is always valid JSON.
+ * Keys and string literals are read from program memory (PSTR).
+ *
+ * Example, prints [["40.1.2.3.4.5.6.7",21],{"n":2}]
+ *
+ *	jsonBegin();
+ *	jsonOpenArray();
+ *		jsonOpenArray(); jsonStr(id); jsonInt(21); jsonCloseArray();
+ *		jsonOpenObject(); jsonKey(PSTR("n")); jsonUInt(2); jsonCloseObject();
+ *	jsonCloseArray();
+ *
+ * Values printed by other routines (e.g. therm_print_devID()) are placed in
+ * the stream by calling jsonValue() right before them.
+ */
+
+#ifndef JSON_H_
+#define JSON_H_
+
+#include "global.h"
+
+// maximum nesting depth of arrays and objects
+#define JSON_MAX_DEPTH	8
+
+//! resets the writer, call before starting a new document
+void jsonBegin(void);
+//! starts a value at the current level (prints a separator if needed)
+void jsonValue(void);
+
+void jsonOpenArray(void);
+void jsonCloseArray(void);
+void jsonOpenObject(void);
+void jsonCloseObject(void);
+
+//! prints an object key stored in program memory, the next call prints its value
+void jsonKey(const char* key);
+
+void jsonUInt(uint16_t n);
+void jsonULong(uint32_t n);
+void jsonInt(int16_t n);
+//! prints a string value from RAM (no escaping is done)
+void jsonStr(char* str);
+//! prints a string value from program memory (no escaping is done)
+void jsonStrP(const char* str);
+void jsonNull(void);
+
+#endif /* JSON_H_ */
@@ -25,24 +25,28 @@
 #include "cmdline.h"
 #include "timer.h"
 #include "onewire.h"
+#include "json.h"
+#include "bench.h"
+#include "trace.h"
+#include "sched.h"
+#include "samplelog.h"
+#include "filter.h"
+#include "health.h"
+#include "stream.h"
 #include "main.h"
 
 #define FW_VERSION "owire 15.12.12"
 
+static SchedTask_t TaskShell;
+// a received character that waits for the bus, see CmdLineLoop
+static uint8_t ShellHeld;
+
 ////////////////////////////////////////////////////////////////
 // INTERRUPT CONTROL
+// the timer only drives the scheduler tick, bus work runs in the tasks
 void Timer0Func(void)
 {
-	if (timer0GetOverflowCount() >= timer0_ovf_count)
-	{
-		if (Flags.stream_timer_0)
-		{
-			timer0ClearOverflowCount();
-			Flags.print_temp = 1;
-			therm_reset();
-			therm_start_measurement();
-		}
-	}
+	schedTick();
 }
 
 ////////////////////////////////////////////////////////////////
@@ -60,16 +64,15 @@ int main(void)
 
 	///////////////////////////////////////////////////////
 	// VARIABLE INIT
-	Flags.print_temp     = 0;
 	Flags.print_json     = 0;
 	Flags.stream_timer_0 = 0;
 
 	///////////////////////////////////////////////////////
 	// TIMER0
 	
-	timer0_ovf_count = 1000;
 	timer0Init();
-	timerAttach(0,Timer0Func);
+	timer1Init();	// free running timebase for delay_us/timerPause
+	timerAttach(0,Timer0Func);	// scheduler tick
 	timer0SetPrescaler(TIMER_CLK_DIV1024);
 
 	///////////////////////////////////////////////////////
@@ -95,8 +98,18 @@ int main(void)
 	cmdlineAddCommand("poke", Poke);
 	cmdlineAddCommand("peek", Peek);
 	cmdlineAddCommand("dump", Dump);
+	cmdlineAddCommand("fmtbench", FormatBenchmark);
+	cmdlineAddCommand("bench", BusBenchmark);
+	cmdlineAddCommand("stats", PrintStats);
+	cmdlineAddCommand("fetch", FetchSamples);
+	cmdlineAddCommand("retry", RetryPolicy);
+	cmdlineAddCommand("health", DeviceHealth);
+#ifdef THERM_TRACE
+	cmdlineAddCommand("trace", PrintTrace);
+#endif
 	cmdlineAddCommand("stream", StreamingControl);
 	cmdlineAddCommand("interval", SetInterval);
+	cmdlineAddCommand("devint", SetDeviceInterval);
 
 	//////////////////////////////////////////////////////////////
 	//
@@ -115,12 +128,21 @@ int main(void)
 	cmdlineAddCommand("search", OneSearch);
 	cmdlineAddCommand("timing", OneWirePrintTimingTabel);
 	cmdlineAddCommand("settiming", OneWireSetTimingTabel);
+	cmdlineAddCommand("speed",  OneWireSpeed);
+	cmdlineAddCommand("tune",   OneWireTune);
 	
 	//cli();
 	therm_init();
+	// clamped to the conversion time, known from therm_init()
+	LoadInterval();
 	GetFW();
 	cmdlinePrintPrompt();
-	CmdLineLoop();
+
+	// deadline ties go to the task added first, the shell is always due
+	streamInit(uartSendByte);
+	TaskShell = schedAdd(CmdLineLoop);
+	schedIn(TaskShell, 0);
+	schedRun();
 	return 0;
 }
 void PrintJson(void)
@@ -128,51 +150,65 @@ void PrintJson(void)
 	uint8_t arg1 = (uint8_t) cmdlineGetArgInt(1);
 	Flags.print_json = arg1;
 }
+// shell task: one pass over the uart input and the command line
 void CmdLineLoop(void)
 {
 	uint8_t  c;
-	// main loop
-	while (1)
+	// pass characters received on the uart (serial port)
+	// into the cmdline processor
+
+	// input is taken every pass, also while the stream owns the bus, so the
+	// uart buffer does not overrun during a conversion. What uses the bus
+	// (the end of a command line, R and S) is held back until the shell
+	// gets it, and the input behind it stays in the uart buffer; so does
+	// the input behind an executing command line.
+	while (!cmdlineIsBusy())
 	{
-		// pass characters received on the uart (serial port)
-		// into the cmdline processor
-		
-		if (Flags.print_temp)
-		{
-			Flags.print_temp = 0;
-			rprintfProgStrM("owtemp\",\"data\":");
-			GetTemperature();			
-			cmdlinePrintPrompt();
-		}
-
-		while (uartReceiveByte(&c))
+		if (ShellHeld)
+			c = ShellHeld;
+		else if (!uartReceiveByte(&c))
+			break;
+		if (c == '\r' || c == '\n' || c == 'R' || c == 'S')
 		{
-			switch (c)
+			if (!therm_bus_acquire(THERM_BUS_SHELL))
 			{
-			{
-			case 'C':
-				vt100ClearScreen();
-				vt100SetCursorPos(1, 1);
-				cmdlinePrintPrompt();
-				break;
-			case 'R':
-				OneWireReset();			
-				break;
-			case 'S':
-				OneWireReset();			
+				ShellHeld = c;
 				break;
-			case 'Z':
-				cmdlineResetPrompt();
-				cmdlinePrintPrompt();
-				break;
-			}
-			default:
-				cmdlineInputFunc(c);
 			}
+			ShellHeld = 0;
+		}
+		switch (c)
+		{
+		{
+		case 'C':
+			vt100ClearScreen();
+			vt100SetCursorPos(1, 1);
+			cmdlinePrintPrompt();
+			break;
+		case 'R':
+			OneWireReset();			
+			break;
+		case 'S':
+			OneWireReset();			
+			break;
+		case 'Z':
+			cmdlineResetPrompt();
+			cmdlinePrintPrompt();
+			break;
+		}
+		default:
+			cmdlineInputFunc(c);
 		}
-		// run the cmdline execution functions
+	}
+	// run the cmdline execution functions once the shell has the bus
+	if (therm_bus_owner() == THERM_BUS_SHELL)
+	{
 		cmdlineMainLoop();
+		// hold the bus across a batch of commands
+		if (!cmdlineIsBusy())
+			therm_bus_release(THERM_BUS_SHELL);
 	}
+	schedIn(TaskShell, 0);
 }
 
 void HelpFunction(void)
@@ -189,8 +225,17 @@ void HelpFunction(void)
 	rprintfProgStrM("peek [reg]       : returns dec, hex and bin value of register\n");
 	rprintfProgStrM("poke [reg] [val] : sets register value to [val] \n");
 	rprintfProgStrM("test             : test function\n");
-
-	rprintfProgStrM("stream           : start streaming\n");
+	rprintfProgStrM("fmtbench         : cycles per temperature printout, old vs new\n");
+
+	rprintfProgStrM("stream [on] [db] [max] : streaming (1 text, 2 binary, 3 log), report changes > db/100 C\n");
+	rprintfProgStrM("fetch [n]        : upload and remove up to n logged samples\n");
+	rprintfProgStrM("retry [tx|s] [n] [ms|max] : retry policy, sweep backoff\n");
+	rprintfProgStrM("health [c]       : device health records, c clears them\n");
+	rprintfProgStrM("interval [n]     : stream every n timer0 overflows\n");
+	rprintfProgStrM("devint [slot] [n] [f] [p] : stream slot every n intervals, filter f: 1 mean/2 median of last p reads, 3 ema\n");
+	rprintfProgStrM("macro [name] [cmds] : list, store or delete a macro\n");
+	rprintfProgStrM("cmd1;cmd2;...    : run several commands, one response\n");
+	rprintfProgStrM("#id cmd          : tag the response frame with request id\n");
 
 	rprintfProgStrM("\n\nOnewire Commands:\n");
 	rprintfProgStrM("rom            : read rom of a single device\n");
@@ -202,6 +247,13 @@ void HelpFunction(void)
 	rprintfProgStrM("data           : read data from 3824 device\n");
 	rprintfProgStrM("rp             : read specific page from 3824 device\n");
 	rprintfProgStrM("wp             : write data to specified page\n");
+	rprintfProgStrM("delay [pin] [us]: pulse pin low for [us] microseconds\n");
+	rprintfProgStrM("timing [od]    : print 1-Wire timing table (us), od=1 overdrive\n");
+	rprintfProgStrM("settiming [n] [us] [od] : set timing table entry [n]\n");
+	rprintfProgStrM("speed [0|1] [slot] [od] : use overdrive for capable devices, mark a slot\n");
+	rprintfProgStrM("bench [loops]  : bus time benchmarks on this pin [us,cycles,bytes,count]\n");
+	rprintfProgStrM("stats [b|c]    : bus and uart counters, b binary, c clear\n");
+	rprintfProgStrM("tune [trials]  : sweep timing on this pin, store centres of the 90% CRC pass windows\n");
 }
 
 void GetFW(void){
@@ -320,6 +372,314 @@ void Dump(void) {
 	rprintf("\r\n");
 
 }
+////////////////////////////////////////////////////////////////
+// Number formatting benchmark
+// Runs the old (rprintf/rprintfNum) and new (rprintfDecU16/rprintfFixed4)
+// temperature formatting on sample values with output discarded, and
+// reports the average cost per value in CPU cycles (Timer1 timebase).
+static void BenchSink(unsigned char c)
+{
+}
+static const int16_t PROGMEM BenchValues[][2] = {{21,625},{-10,1250},{125,0},{0,9375}};
+#define BENCH_NUM_VALUES (sizeof(BenchValues)/sizeof(BenchValues[0]))
+
+static uint16_t BenchFormat(uint8_t fast)
+{
+	uint8_t i;
+	int16_t ipart;
+	uint16_t frac, start, cycles;
+
+	rprintfInit(BenchSink);
+	cli();
+	start = TCNT1;
+	for (i = 0; i < BENCH_NUM_VALUES; i++)
+	{
+		ipart = pgm_read_word(&BenchValues[i][0]);
+		frac  = pgm_read_word(&BenchValues[i][1]);
+		if (fast)
+			rprintfFixed4(ipart, frac);
+		else
+		{
+			rprintf("%d.", ipart);
+			rprintfNum(10, 4, 0, '0', frac);
+		}
+	}
+	cycles = (TCNT1 - start)*(F_CPU/1000000/TIMER1_TICKS_PER_US);
+	sei();
+	rprintfInit(uartSendByte);
+	return cycles / BENCH_NUM_VALUES;
+}
+
+void FormatBenchmark(void)
+{
+	uint16_t old_cycles = BenchFormat(0);
+	uint16_t new_cycles = BenchFormat(1);
+
+	jsonBegin();
+	jsonOpenObject();
+	jsonKey(PSTR("rprintf"));   jsonUInt(old_cycles);
+	jsonKey(PSTR("fixed4"));    jsonUInt(new_cycles);
+	jsonCloseObject();
+	cmdlinePrintPromptEnd();
+}
+
+////////////////////////////////////////////////////////////////
+// Bus time benchmarks on the current pin (see bench.h)
+// bench [crc loops]: {"search":[us,cycles,bytes,count],...}
+static void BenchPrint(const char* name, BenchResult_t *r)
+{
+	jsonKey(name);
+	jsonOpenArray();
+	jsonULong(r->bus_us);
+	jsonULong(r->cpu);
+	jsonUInt(r->out);
+	jsonUInt(r->count);
+	jsonCloseArray();
+}
+
+void BusBenchmark(void)
+{
+	uint16_t loops = (uint16_t) cmdlineGetArgInt(1);
+	BenchResult_t search, sweep, rom, page, crc;
+
+	if (loops == 0)
+		loops = 100;
+	benchInit(uartSendByte);
+	benchSearch(&search);
+	benchSweep(&sweep, 0, 0);
+	benchReadRom(&rom);
+	benchPage(&page);
+	benchCrc(&crc, loops);
+
+	jsonBegin();
+	jsonOpenObject();
+	BenchPrint(PSTR("search"), &search);
+	BenchPrint(PSTR("sweep"),  &sweep);
+	BenchPrint(PSTR("readrom"),&rom);
+	BenchPrint(PSTR("page"),   &page);
+	BenchPrint(PSTR("crc"),    &crc);
+	jsonCloseObject();
+	cmdlinePrintPromptEnd();
+}
+
+////////////////////////////////////////////////////////////////
+// Bus and UART statistics
+// stats   : {"pins":[[transactions,bytes,crc_errors,presence_fail,retries,
+//                     max_us,avg_us],...],"uart":[rx_overflow,tx_stall]}
+// stats b : frame of type 'S' (see streamSendFrame) with the payload
+//           ThermStats_t[THERM_NUM_PINS], rx_overflow (u16), tx_stall (u32),
+//           raw little endian
+// stats c : clear all counters
+void PrintStats(void)
+{
+	uint8_t *arg = cmdlineGetArgStr(1);
+	uint8_t frame[THERM_NUM_PINS * sizeof(ThermStats_t) + sizeof(uint16_t) + sizeof(uint32_t)];
+	ThermStats_t *st;
+	uint8_t pin, n;
+	uint16_t rx = uartRxOverflow;
+	uint32_t tx = uartTxStall;
+
+	if (arg[0] == 'c')
+	{
+		therm_clear_stats();
+		uartRxOverflow = 0;
+		uartTxStall    = 0;
+		rprintfProgStrM("1");
+	}
+	else if (arg[0] == 'b')
+	{
+		for (pin = n = 0; pin < THERM_NUM_PINS; pin++, n += sizeof(ThermStats_t))
+			memcpy(&frame[n], therm_get_stats(pin), sizeof(ThermStats_t));
+		frame[n++] = rx;
+		frame[n++] = rx >> 8;
+		n += streamPutU32(&frame[n], tx);
+		streamSendFrame('S', frame, n);
+	}
+	else
+	{
+		jsonBegin();
+		jsonOpenObject();
+		jsonKey(PSTR("pins"));
+		jsonOpenArray();
+		for (pin = 0; pin < THERM_NUM_PINS; pin++)
+		{
+			st = therm_get_stats(pin);
+			jsonOpenArray();
+			jsonUInt(st->transactions);
+			jsonULong(st->bytes);
+			jsonUInt(st->crc_errors);
+			jsonUInt(st->presence_fail);
+			jsonUInt(st->retries);
+			jsonUInt(st->t_max_us);
+			jsonULong(st->transactions ? st->t_sum_us / st->transactions : 0);
+			jsonCloseArray();
+		}
+		jsonCloseArray();
+		jsonKey(PSTR("uart"));
+		jsonOpenArray();
+		jsonUInt(rx);
+		jsonULong(tx);
+		jsonCloseArray();
+		jsonCloseObject();
+	}
+	cmdlinePrintPromptEnd();
+}
+
+////////////////////////////////////////////////////////////////
+// Retry policy
+// retry                 : {"tx":[[retries,recover_ms],...],"skip":[after,max]}
+//                         with tx in the order temperature, ROM, page
+// retry [tx] [n] [ms]   : repeat a failed transaction of type tx n times,
+//                         after ms of idle bus and a reset (0 = at once)
+// retry s [after] [max] : quarantine a device after <after> failed reads in
+//                         a row (0 = never), the stream then backs off up
+//                         to <max> sweeps (health.h)
+void RetryPolicy(void)
+{
+	uint8_t *arg = cmdlineGetArgStr(1);
+	ThermRetry_t *r;
+	uint8_t i;
+
+	if (arg[0] == 's')
+	{
+		HealthSkipAfter = (uint8_t) cmdlineGetArgInt(2);
+		HealthSkipMax   = (uint8_t) cmdlineGetArgInt(3);
+		if (HealthSkipMax == 0)
+			HealthSkipMax = 1;
+	}
+	else if (arg[0])
+		therm_set_retry((uint8_t) cmdlineGetArgInt(1), (uint8_t) cmdlineGetArgInt(2),
+				(uint8_t) cmdlineGetArgInt(3));
+	jsonBegin();
+	jsonOpenObject();
+	jsonKey(PSTR("tx"));
+	jsonOpenArray();
+	for (i = 0; i < THERM_TX_TYPES; i++)
+	{
+		r = therm_get_retry(i);
+		jsonOpenArray();
+		jsonUInt(r->retries);
+		jsonUInt(r->recover_ms);
+		jsonCloseArray();
+	}
+	jsonCloseArray();
+	jsonKey(PSTR("skip"));
+	jsonOpenArray();
+	jsonUInt(HealthSkipAfter);
+	jsonUInt(HealthSkipMax);
+	jsonCloseArray();
+	jsonCloseObject();
+	cmdlinePrintPromptEnd();
+}
+
+////////////////////////////////////////////////////////////////
+// Device health of the stored devices of the pin
+// health   : {"now":ms,"dev":[[slot,fails,rate,quarantined,last_good],...]}
+//            fails in a row, error rate in %, last good read in ms (0 = never)
+// health c : forgets the records
+void DeviceHealth(void)
+{
+	Health_t *h;
+	uint8_t i;
+
+	if (cmdlineGetArgStr(1)[0] == 'c')
+		healthClear();
+	jsonBegin();
+	jsonOpenObject();
+	jsonKey(PSTR("now"));
+	jsonULong(hal_millis());
+	jsonKey(PSTR("dev"));
+	jsonOpenArray();
+	for (i = 0; i < THERM_REGISTRY_SIZE; i++)
+	{
+		if (!therm_load_devID(i))
+			continue;
+		h = healthGet(i);
+		jsonOpenArray();
+		jsonUInt(i);
+		jsonUInt(h->fails);
+		jsonUInt((uint16_t) h->rate * 100 >> 8);
+		jsonUInt(healthQuarantined(h));
+		jsonULong(h->last_good);
+		jsonCloseArray();
+	}
+	jsonCloseArray();
+	jsonCloseObject();
+	cmdlinePrintPromptEnd();
+}
+
+////////////////////////////////////////////////////////////////
+// Sample log upload, oldest first; the records are removed as they are sent
+// fetch [n] : frames of type 'L' (see streamSendFrame) with the payload
+//             dropped (u16), now (u32 ms), then per record
+//             time (u32 ms), slot (u8, bit 7 = read error), value (i16, 1/16 C)
+//             little endian; at least one frame, n = 0 fetches everything
+#define FETCH_RECORDS	12
+void FetchSamples(void)
+{
+	uint8_t max = (uint8_t) cmdlineGetArgInt(1);
+	uint8_t frame[6 + FETCH_RECORDS * 7];
+	SampleRecord_t rec;
+	uint16_t v;
+	uint8_t n;
+
+	if (max == 0 || max > sampleLogCount())
+		max = sampleLogCount();
+	do
+	{
+		v = sampleLogDropped();
+		frame[0] = v;
+		frame[1] = v >> 8;
+		n = 2 + streamPutU32(&frame[2], hal_millis());
+		while (max && n < sizeof(frame) && sampleLogGet(&rec))
+		{
+			max--;
+			n += streamPutU32(&frame[n], rec.time);
+			frame[n++] = rec.slot;
+			frame[n++] = rec.value;
+			frame[n++] = rec.value >> 8;
+		}
+		streamSendFrame('L', frame, n);
+	} while (max);
+	cmdlinePrintPromptEnd();
+}
+
+#ifdef THERM_TRACE
+////////////////////////////////////////////////////////////////
+// 1-Wire event trace, oldest first; the records are removed as they are
+// printed (host/trace2vcd renders the output as VCD)
+// trace   : {"trace":[[event,data,tick],...]}
+// trace c : clear the ring
+void PrintTrace(void)
+{
+	TraceRecord_t rec;
+
+	if (cmdlineGetArgStr(1)[0] == 'c')
+	{
+		traceClear();
+		rprintfProgStrM("1");
+	}
+	else
+	{
+		jsonBegin();
+		jsonOpenObject();
+		jsonKey(PSTR("trace"));
+		jsonOpenArray();
+		while (traceGet(&rec))
+		{
+			jsonOpenArray();
+			jsonUInt(rec.event);
+			jsonUInt(rec.data);
+			jsonUInt(rec.tick);
+			jsonCloseArray();
+		}
+		jsonCloseArray();
+		jsonCloseObject();
+	}
+	cmdlinePrintPromptEnd();
+}
+#endif
+
 //////////////////////////////////////////
 void ResetCounters(void){
 	TCNT1                = 0;
@@ -329,24 +689,76 @@ void ResetCounters(void){
 }
 /////////////////////////////////////////////////////////////////////////////////////
 // STREAMING FUNCTION
+// stream [on] [deadband] [max_silence] : on 1 = text, 2 = binary records,
+// 3 = into the sample log (fetch);
+// deadband in 1/100 C (0 = report every read), max_silence in reads of a
+// slot (0 = only on change)
 void StreamingControl(void){
-	Flags.stream_timer_0 = (uint8_t) cmdlineGetArgInt(1);
+	streamStart((uint8_t) cmdlineGetArgInt(1), (uint16_t) cmdlineGetArgInt(2),
+			(uint8_t) cmdlineGetArgInt(3));
 	rprintf("%d",Flags.stream_timer_0);
 	cmdlinePrintPromptEnd();
 }
+// the stored stream interval, 1000 ticks while the eeprom is erased
+void LoadInterval(void){
+	uint16_t ticks = eeprom_read_word(&eep_timer0_ovf_count);
+
+	streamSetInterval((ticks == 0 || ticks == 0xffff) ? 1000 : ticks);
+}
 void SetInterval(void){
-	timer0_ovf_count = (uint16_t) cmdlineGetArgInt(1);
-	if (timer0_ovf_count == 0)
+	uint16_t ticks = (uint16_t) cmdlineGetArgInt(1);
+
+	// 0 goes back to the stored interval
+	if (ticks == 0)
+		LoadInterval();
+	else
+	{
+		streamSetInterval(ticks);
+		eeprom_write_word(&eep_timer0_ovf_count, streamGetInterval());
+	}
+	rprintf("%d",streamGetInterval());
+	cmdlinePrintPromptEnd();
+}
+// devint                    : [[slot,periods,filter,param],...] for the
+//                              stored devices of the pin
+// devint [slot] [n] [f] [p]  : stream the slot every n intervals (1..254)
+//                              and, when f is given, through filter f
+//                              with parameter p (filter.h: 1 sliding mean,
+//                              2 sliding median of the last p streamed
+//                              reads, 3 EMA, 0 = none); filters are kept
+//                              in RAM, one that does not fit is refused
+void SetDeviceInterval(void){
+	uint8_t slot    = (uint8_t) cmdlineGetArgInt(1);
+	uint8_t periods = (uint8_t) cmdlineGetArgInt(2);
+	uint8_t i;
+
+	if (periods && slot < THERM_REGISTRY_SIZE)
 	{
-		eeprom_read_dword(&timer0_ovf_count);
-		rprintf("%d",timer0_ovf_count);
+		therm_set_interval(slot, periods);
+		if (cmdlineGetArgStr(3)[0])
+			filterSet(slot, (uint8_t) cmdlineGetArgInt(3), (uint8_t) cmdlineGetArgInt(4));
+		rprintf("%d", therm_get_interval(slot));
 	}
+	else if (periods)
+		rprintfProgStrM("0");
 	else
 	{
-		eeprom_write_dword(&eep_timer0_ovf_count, timer0_ovf_count);
-		rprintf("%d",timer0_ovf_count);
-		cmdlinePrintPromptEnd();
+		jsonBegin();
+		jsonOpenArray();
+		for (i = 0; i < THERM_REGISTRY_SIZE; i++)
+		{
+			if (!therm_load_devID(i))
+				continue;
+			jsonOpenArray();
+			jsonUInt(i);
+			jsonUInt(therm_get_interval(i));
+			jsonUInt(filterGetType(i));
+			jsonUInt(filterGetParam(i));
+			jsonCloseArray();
+		}
+		jsonCloseArray();
 	}
+	cmdlinePrintPromptEnd();
 }
 ////////////////////////////////////////////////////////////////
 // ONE WIRE DEVICES
@@ -354,6 +766,12 @@ void SetInterval(void){
 void ChangeTmermPin(void)
 {
 	therm_set_pin((uint8_t)cmdlineGetArgInt(1));
+	// reported values and filters belong to the registry of the old pin
+	filterClear();
+	healthClear();
+	streamResetReports();
+	rprintf("%d",therm_get_pin());
+	cmdlinePrintPromptEnd();
 }
 void StartTemperatureMeasurement(void){
 	therm_reset();
@@ -362,54 +780,7 @@ void StartTemperatureMeasurement(void){
 	cmdlinePrintPromptEnd();
 }
 void GetTemperature(void){
-	int16_t t[2];
-	uint8_t i, device_count = 0, loop_count=0;
-	int8_t devNum = 0;//(int8_t) cmdlineGetArgInt(1);
-	
-	if(Flags.print_json)
-	{
-		rprintfProgStrM("[");
-	}
-	else
-	{
-		rprintfCRLF();
-	}
-	
-	for (i = 1; i <= MAX_NUMBER_OF_1WIRE_DEVICES; i++)
-	{
-		if (therm_load_devID(i) == 1)
-		{
-			loop_count++;
-			if(Flags.print_json)
-			{
-				json_open_bracket();
-				therm_print_devID();json_comma();
-				therm_read_result(t);json_comma();
-				therm_print_scratchpad();
-				json_end_bracket();
-				json_comma();
-			}
-			else{
-				rprintf("%d : ", loop_count);
-				therm_print_devID();
-				rprintfProgStrM(" : ");
-				therm_read_result(t);
-				rprintfProgStrM(" : ");
-				therm_print_scratchpad();
-				rprintfCRLF();
-			}
-		}
-	}
-	if(Flags.print_json)
-	{
-		rprintfProgStrM("[\"0\",0,0]]");
-		cmdlinePrintPromptEnd();
-	}
-	else
-	{
-		rprintfCRLF();
-		cmdlinePrintPromptEnd();
-	}
+	streamPrintTemperatures(0xFFFFFFFF, 0);
 }
 void GetOneWireMeasurements(void)
 {
@@ -427,43 +798,42 @@ void OneWireReadRom(void){
 	cmdlinePrintPromptEnd();
 }
 void OneWireLoadRom(void){
-	uint8_t pin, i, done=0;
+	uint8_t pin, i, old_pin = therm_get_pin();
 
+	if (Flags.print_json)
+	{
+		jsonBegin();
+		jsonOpenArray();
+	}
 	for (pin = 0; pin < 3; pin++)
 	{		
 		therm_set_pin(pin);
 		if (Flags.print_json) 
-			rprintfProgStrM("[");		
-		done = 0;
-		for (i = 0; i < 20, done == 0; i++)
+			jsonOpenArray();
+		for (i = 0; i < MAX_NUMBER_OF_1WIRE_DEVICES; i++)
 		{
+			if (!therm_load_devID(i))
+				continue;
 			if (Flags.print_json)
 			{
-				rprintf("[%d,",i);
-					if (therm_load_devID(i))
-						therm_print_devID();
-					else
-						rprintfProgStrM("[]");
-
-					if (i<MAX_NUMBER_OF_1WIRE_DEVICES-1)
-						rprintf("],");
-					else
-						rprintfProgStrM("]");
+				jsonOpenArray();
+				jsonUInt(i);
+				jsonValue(); therm_print_devID();
+				jsonCloseArray();
 			}
 			else
-				{	
-					if (therm_load_devID(i)){
-						rprintf("%d, %d, ",pin,i);
-						therm_print_devID();
-						rprintfCRLF();
-					}else{
-						done = 1;
-					}
-				}
-				if (Flags.print_json) 
-					rprintfProgStrM("]");				
+			{	
+				rprintf("%d, %d, ",pin,i);
+				therm_print_devID();
+				rprintfCRLF();
 			}
+		}
+		if (Flags.print_json) 
+			jsonCloseArray();
 	}
+	if (Flags.print_json)
+		jsonCloseArray();
+	therm_set_pin(old_pin);
 	cmdlinePrintPromptEnd();
 }
 void SaveThermometerIdToRom(void){
@@ -475,6 +845,7 @@ void SaveThermometerIdToRom(void){
 	if (devID[0] != 0)
 		therm_set_devID(devID);
 	therm_save_devID(devNum);
+	healthForget(devNum);
 	OneWireLoadRom();
 }
 void OneWireReadPage(void){
@@ -489,7 +860,7 @@ void OneWireWritePage(void){
 	uint8_t  val  = (uint8_t) cmdlineGetArgInt(2);
 	
     write_to_page(page, val);
-	_delay_ms(1);
+	timerPause(1);
 	recal_memory_page(page);
 	therm_print_scratchpad();
 	cmdlinePrintPromptEnd();
@@ -512,6 +883,11 @@ void OneSearch(void){
 			devNum++;
 		}
 	}
+	// the slots got new devices, and the search ends on another pin; as
+	// in ChangeTmermPin the records, filters and reported values go
+	filterClear();
+	healthClear();
+	streamResetReports();
 	cmdlinePrintPromptEnd();
 }
 void OneWireReset(void)
@@ -523,17 +899,57 @@ void OneWireDelay(void){
 	uint16_t  pin = (uint16_t) cmdlineGetArgInt(1);
 	uint16_t  val = (uint16_t) cmdlineGetArgInt(2);
 	PIN_LOW(THERM_PORT,pin);
-	therm_delay(val);
+	therm_delay(therm_us_to_loops(val));
 	PIN_HIGH(THERM_PORT,pin);
 }
 
 void OneWirePrintTimingTabel(void)
 {
-	therm_print_timing();
+	uint8_t  speed = (uint8_t) cmdlineGetArgInt(1);
+	if (speed < THERM_NUM_SPEEDS)
+		therm_print_timing(speed);
 }
 
 void OneWireSetTimingTabel(void){
 	uint8_t  time      = (uint8_t)  cmdlineGetArgInt(1);
 	uint16_t interval  = (uint16_t) cmdlineGetArgInt(2);
-	therm_set_timing(time, interval);
+	uint8_t  speed     = (uint8_t)  cmdlineGetArgInt(3);
+	if (speed < THERM_NUM_SPEEDS)
+		therm_set_timing(speed, time, interval);
+}
+
+void OneWireTune(void){
+	uint8_t trials = (uint8_t) cmdlineGetArgInt(1);
+	uint8_t window[THERM_TUNE_PARAMS][3];
+	uint8_t i;
+
+	if (trials == 0)
+		trials = THERM_TUNE_TRIALS;
+	therm_tune(trials, window);
+
+	// [[entry,first_pass_us,last_pass_us],...], 0,0 when nothing passed
+	jsonBegin();
+	jsonOpenArray();
+	for (i = 0; i < THERM_TUNE_PARAMS; i++)
+	{
+		jsonOpenArray();
+		jsonUInt(window[i][0]);
+		jsonUInt(window[i][1]);
+		jsonUInt(window[i][2]);
+		jsonCloseArray();
+	}
+	jsonCloseArray();
+	cmdlinePrintPromptEnd();
+}
+
+// speed [on]             : address overdrive capable devices at overdrive speed
+// speed [on] [slot] [od] : and mark the registry slot as overdrive capable
+//                          (1) or not (0); search and save set the mark
+//                          from the family code
+void OneWireSpeed(void){
+	therm_enable_overdrive((uint8_t) cmdlineGetArgInt(1));
+	if (cmdlineGetArgStr(2)[0])
+		therm_set_overdrive((uint8_t) cmdlineGetArgInt(2), (uint8_t) cmdlineGetArgInt(3));
+	rprintf("%d",(uint8_t) cmdlineGetArgInt(1) != 0);
+	cmdlinePrintPromptEnd();
 }
\ No newline at end of file
@@ -17,10 +17,8 @@ uint8_t EEMEM eep_devid = 1;
 uint16_t EEMEM eep_timer0_ovf_count = 200;
 Label_t eep_dev_sn[1] EEMEM;
 Label_t eep_dev_location[1] EEMEM;
-Label_t eep_adc_sn[NUM_OF_ADCS] EEMEM;
 
 uint8_t  timer1_ovf_count;
-uint16_t timer0_ovf_count;
 uint16_t timer1_count;
 
 
@@ -38,6 +36,10 @@ void test(void);
 void Poke(void);
 void Peek(void);
 void Dump(void);
+void FormatBenchmark(void);
+void BusBenchmark(void);
+void PrintStats(void);
+void PrintTrace(void);
 void OneWireDelay(void);
 void StartTemperatureMeasurement(void);
 void GetTemperature(void);
@@ -53,10 +55,17 @@ void OneWireReset(void);
 void ChangeTmermPin(void);
 void OneWirePrintTimingTabel(void);
 void OneWireSetTimingTabel(void);
+void OneWireSpeed(void);
+void OneWireTune(void);
 void PrintLabel(Label_t *eep_label);
 void PrintJson(void);
 
 
+void LoadInterval(void);
 void SetInterval(void);
+void SetDeviceInterval(void);
+void FetchSamples(void);
+void RetryPolicy(void);
+void DeviceHealth(void);
 
 #endif /* MAIN_H_ */
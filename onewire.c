@@ -1,25 +1,108 @@
 
-#include <avr/io.h>
-#include <util/delay.h>
-#include <avr/eeprom.h>
-#include <avr/interrupt.h>
+#include <string.h>
 #include "global.h"
+#include "hal.h"
 #include "onewire.h"
+#include "trace.h"
+
+// timing in microseconds (Maxim AN126 recommended values, overdrive rounded to whole us)
+#define THERM_TIMING_DEFAULTS \
+		{ \
+			/* standard speed */ \
+			{ \
+				480,  /* t_reset_tx    H: reset low time */ \
+				410,  /* t_reset_rx    J: rest of the reset slot after the presence sample */ \
+				70,   /* t_reset_delay I: release to presence sample */ \
+				6,    /* t_write_low   A: slot start low time (write 1 / read) */ \
+				54,   /* t_write_slot  C-A: further low time of a write 0 */ \
+				9,    /* t_read_samp   E: release to read sample */ \
+				55,   /* t_read_slot   F: rest of the read slot after the sample */ \
+				10,   /* t_write_rec   D: recovery after a write slot */ \
+			}, \
+			/* overdrive speed */ \
+			{ \
+				70,   /* t_reset_tx    H */ \
+				40,   /* t_reset_rx    J */ \
+				9,    /* t_reset_delay I (8.5) */ \
+				1,    /* t_write_low   A */ \
+				7,    /* t_write_slot  C-A (7.5 - 1) */ \
+				1,    /* t_read_samp   E */ \
+				7,    /* t_read_slot   F */ \
+				3,    /* t_write_rec   D (2.5) */ \
+			}, \
+		}
+
+// every bus starts from the same defaults, tune or settiming adjusts each pin
+EE_RAM_t EEMEM eeprom =
+{
+		750,  // t_conv ms, DS18B20 at 12 bit (tCONV max)
+		{
+			THERM_TIMING_DEFAULTS,
+			THERM_TIMING_DEFAULTS,
+			THERM_TIMING_DEFAULTS,
+			THERM_TIMING_DEFAULTS,
+		},
+};
 
-EE_RAM_t __attribute__((section (".eeprom"))) eeprom =
+// families that accept Overdrive Skip/Match ROM
+static const uint8_t PROGMEM therm_od_families[] =
 {
-		150,  // t_conv ms
-		1100, // uint8_t  t_reset_tx;
-		1100, // uint8_t  t_reset_rx;
-		35,   // t_reset_delay
-		30,   // uint8_t  t_write_low;
-		100,  // uint8_t  t_write_slot;
-		30,   // uint8_t  t_read_samp;
-		100,  // uint8_t  t_read_slot;
+		0x1C, // DS28E04
+		0x23, // DS2433
+		0x29, // DS2408
+		0x2D, // DS2431
+		0x37, // DS1977
+		0x3A, // DS2413
+		0x42, // DS28EA00
+		0x43, // DS28EC20
 };
 
 DS_t DS;
 
+ThermStats_t ThermStats[THERM_NUM_PINS];
+// current transaction: start and time of the last byte, in hal_ticks()
+// (hal_micros() wraps at 2^31 us)
+static uint32_t ThermStatStart;
+static uint32_t ThermStatLast;
+static uint8_t  ThermStatOpen;
+
+// ends the open transaction of the current pin
+static void therm_stat_close(void)
+{
+	ThermStats_t *st = &ThermStats[DS.therm_pin];
+	uint32_t dt;
+
+	if (!ThermStatOpen)
+		return;
+	ThermStatOpen = 0;
+	dt = (ThermStatLast - ThermStatStart) / HAL_TICKS_PER_US;
+	if (dt > 0xFFFF)
+		dt = 0xFFFF;
+	if (dt > st->t_max_us)
+		st->t_max_us = dt;
+	st->t_sum_us += dt;
+}
+
+static uint8_t therm_stat_crc(uint8_t no_error)
+{
+	if (!no_error)
+		ThermStats[DS.therm_pin].crc_errors++;
+	TRACE(TRACE_EV_CRC, no_error);
+	return no_error;
+}
+
+ThermStats_t *therm_get_stats(uint8_t pin)
+{
+	therm_stat_close();
+	return &ThermStats[pin];
+}
+
+void therm_clear_stats(void)
+{
+	ThermStatOpen = 0;
+	memset(ThermStats, 0, sizeof(ThermStats));
+}
+
 void therm_init(void)
 {
 	uint8_t i;
@@ -27,74 +110,216 @@ void therm_init(void)
 		DS.scratchpad[i] = 0;
 	for (i = 0; i < 8; i++)
 		DS.devID[i] = 0;
-	DS.therm_pin = PINB0;
-	PIN_HIGH(TRIG_PORT,TRIG_RESET_PIN);
-	PIN_HIGH(TRIG_PORT,TRIG_READ_PIN);
-	PIN_HIGH(TRIG_PORT,TRIG_BYTE_PIN);
+	DS.therm_pin = 0;
+	DS.od_enable = 0;
+	HAL_TRIG_HIGH(TRIG_RESET_PIN);
+	HAL_TRIG_HIGH(TRIG_READ_PIN);
+	HAL_TRIG_HIGH(TRIG_BYTE_PIN);
 	
 	DS.t_conv       = eeprom_read_word(&eeprom.t_conv);
-	DS.t_reset_tx   = eeprom_read_word(&eeprom.t_reset_tx);
-	DS.t_reset_rx   = eeprom_read_word(&eeprom.t_reset_rx);
-	DS.t_reset_delay= eeprom_read_word(&eeprom.t_reset_delay);
-	DS.t_write_low  = eeprom_read_byte(&eeprom.t_write_low);
-	DS.t_write_slot = eeprom_read_byte(&eeprom.t_write_slot);
-	DS.t_read_samp  = eeprom_read_byte(&eeprom.t_read_samp);
-	DS.t_read_slot  = eeprom_read_byte(&eeprom.t_read_slot);
+	therm_set_speed(THERM_SPEED_STD);
+}
+
+void therm_set_speed(uint8_t speed)
+{
+	Timing_t *t = &eeprom.timing[DS.therm_pin][speed];
+
+	// eeprom holds microseconds, the bit routines use exact delay loop counts
+	DS.speed        = speed;
+	DS.t_reset_tx   = therm_us_to_loops(eeprom_read_word(&t->t_reset_tx));
+	DS.t_reset_rx   = therm_us_to_loops(eeprom_read_word(&t->t_reset_rx));
+	DS.t_reset_delay= therm_us_to_loops(eeprom_read_word(&t->t_reset_delay));
+	DS.t_write_low  = therm_us_to_loops(eeprom_read_byte(&t->t_write_low));
+	DS.t_write_slot = therm_us_to_loops(eeprom_read_byte(&t->t_write_slot));
+	DS.t_read_samp  = therm_us_to_loops(eeprom_read_byte(&t->t_read_samp));
+	DS.t_read_slot  = therm_us_to_loops(eeprom_read_byte(&t->t_read_slot));
+	DS.t_write_rec  = therm_us_to_loops(eeprom_read_byte(&t->t_write_rec));
+}
+
+void therm_enable_overdrive(uint8_t enable)
+{
+	DS.od_enable = enable;
+}
+
+uint8_t therm_supports_overdrive(uint8_t family)
+{
+	uint8_t i;
+	for (i = 0; i < sizeof(therm_od_families); i++)
+		if (pgm_read_byte(&therm_od_families[i]) == family)
+			return 1;
+	return 0;
+}
+
+uint8_t therm_get_overdrive(uint8_t devNum)
+{
+	return (eeprom_read_dword(&eeprom.od[DS.therm_pin]) >> devNum) & 1;
+}
+
+void therm_set_overdrive(uint8_t devNum, uint8_t capable)
+{
+	uint32_t od, bit = (uint32_t) 1 << devNum;
+
+	if (devNum >= THERM_REGISTRY_SIZE)
+		return;
+	od = eeprom_read_dword(&eeprom.od[DS.therm_pin]);
+	od = capable ? (od | bit) : (od & ~bit);
+	eeprom_write_dword(&eeprom.od[DS.therm_pin], od);
+}
+
+uint16_t therm_us_to_loops(uint16_t us)
+{
+	uint16_t loops;
+	if (us > THERM_MAX_DELAY_US)
+		us = THERM_MAX_DELAY_US;
+	loops = us * THERM_LOOPS_PER_US;
+	// remove the fixed cost of the therm_delay() call, keep at least one loop
+	if (loops > THERM_DELAY_OVERHEAD + 1)
+		return loops - THERM_DELAY_OVERHEAD;
+	return 1;
 }
 
 void therm_set_pin(uint8_t newPin)
 {
+	if (newPin >= THERM_NUM_PINS)
+		return;
+	therm_stat_close();
+	// each bus has its own timing profile
 	DS.therm_pin = newPin;
+	therm_set_speed(THERM_SPEED_STD);
+}
+uint8_t therm_get_pin(void)
+{
+	return DS.therm_pin;
 }
-void therm_delay(uint16_t delay)
+
+uint16_t therm_get_conv_time(void)
+{
+	return DS.t_conv;
+}
+
+//////////////////////////////////////////////////////////////
+// Bus arbiter
+// A transaction that spans several scheduler tasks (start a conversion,
+// read it later) owns the bus in between; other owners wait for it.
+static uint8_t ThermBusOwner = THERM_BUS_FREE;
+
+uint8_t therm_bus_acquire(uint8_t owner)
+{
+	if (ThermBusOwner != THERM_BUS_FREE && ThermBusOwner != owner)
+		return 0;
+	ThermBusOwner = owner;
+	return 1;
+}
+
+void therm_bus_release(uint8_t owner)
+{
+	if (ThermBusOwner == owner)
+		ThermBusOwner = THERM_BUS_FREE;
+}
+
+uint8_t therm_bus_owner(void)
+{
+	return ThermBusOwner;
+}
+void therm_delay(uint16_t loops)
+{
+	// 4 cycles per iteration independent of compiler output (0 would mean 65536)
+	if (loops)
+		hal_delay_loops(loops);
+}
+
+//////////////////////////////////////////////////////////////
+// Retry policy
+static ThermRetry_t ThermRetry[THERM_TX_TYPES] =
+{
+	{2, 0},		// temperature
+	{2, 0},		// ROM
+	{2, 1},		// DS2438 page, Recall Memory and Read Scratchpad
+};
+
+void therm_set_retry(uint8_t type, uint8_t retries, uint8_t recover_ms)
 {
-	while (delay--)
-		asm volatile("nop");
+	if (type >= THERM_TX_TYPES)
+		return;
+	ThermRetry[type].retries    = retries;
+	ThermRetry[type].recover_ms = recover_ms;
+}
+
+ThermRetry_t *therm_get_retry(uint8_t type)
+{
+	return &ThermRetry[type];
+}
+
+// called after a failed attempt, returns 1 when the transaction is repeated
+static uint8_t therm_retry(uint8_t type, uint8_t *attempt)
+{
+	ThermRetry_t *r = &ThermRetry[type];
+
+	if (*attempt >= r->retries)
+		return 0;
+	(*attempt)++;
+	ThermStats[DS.therm_pin].retries++;
+	// let the line recharge and bring every slave back to the reset state
+	if (r->recover_ms)
+	{
+		hal_delay_ms(r->recover_ms);
+		therm_reset();
+	}
+	return 1;
 }
 
 uint8_t therm_reset()
 {
 	uint8_t i;
-	PIN_LOW(TRIG_PORT,TRIG_RESET_PIN);
-	THERM_OUTPUT_MODE(THERM_DDR, 1);
-	THERM_LOW(THERM_PORT, DS.therm_pin);
-	THERM_OUTPUT_MODE(THERM_DDR, DS.therm_pin);
+	// a standard speed reset also returns overdrive devices to standard speed
+	if (DS.speed != THERM_SPEED_STD)
+		therm_set_speed(THERM_SPEED_STD);
+	therm_stat_close();
+	ThermStats[DS.therm_pin].transactions++;
+	ThermStatStart = ThermStatLast = hal_ticks();
+	ThermStatOpen  = 1;
+	TRACE_EPOCH();
+	HAL_TRIG_LOW(TRIG_RESET_PIN);
+	HAL_BUS_LOW(DS.therm_pin);
+	TRACE(TRACE_EV_RESET, DS.therm_pin);
 	therm_delay(DS.t_reset_tx); //480 us
-	THERM_INPUT_MODE(THERM_DDR, DS.therm_pin);
-	//while (bit_is_clear(THERM_PIN, DS.therm_pin));
-	therm_delay(DS.t_reset_delay);
-	PIN_HIGH(TRIG_PORT,TRIG_RESET_PIN);
-	//i = READ_PIN(THERM_PIN, DS.therm_pin);
+	HAL_BUS_RELEASE(DS.therm_pin);
+	therm_delay(DS.t_reset_delay); //70 us
+	HAL_TRIG_HIGH(TRIG_RESET_PIN);
 	i = therm_read_n_times(10,5);
-	PIN_LOW(TRIG_PORT,TRIG_RESET_PIN);
-	//PIN_HIGH(THERM_PORT,1);
-	therm_delay(DS.t_reset_rx); //480 us
+	HAL_TRIG_LOW(TRIG_RESET_PIN);
+	therm_delay(DS.t_reset_rx); //410 us
 	//Return the value read from the presence pulse (0=OK, 1=WRONG)
-	PIN_HIGH(TRIG_PORT,TRIG_RESET_PIN);
+	HAL_TRIG_HIGH(TRIG_RESET_PIN);
+	TRACE(TRACE_EV_PRESENCE, i);
+	if (i)
+		ThermStats[DS.therm_pin].presence_fail++;
 	return i;
 }
 
 void therm_write_bit(uint8_t bit)
 {
-	//Pull line low for 1uS
-	THERM_LOW(THERM_PORT, DS.therm_pin);
-	THERM_OUTPUT_MODE(THERM_DDR, DS.therm_pin);
+	//Pull line low for 6uS
+	HAL_BUS_LOW(DS.therm_pin);
 	therm_delay(DS.t_write_low);
 	//If we want to write 1, release the line (if not will keep low)
 	if (bit)
-		THERM_INPUT_MODE(THERM_DDR, DS.therm_pin);
-	//Wait for 60uS and release the line
+		HAL_BUS_RELEASE(DS.therm_pin);
+	//Wait for 54uS and release the line
 	therm_delay(DS.t_write_slot);
-	THERM_INPUT_MODE(THERM_DDR, DS.therm_pin);
+	HAL_BUS_RELEASE(DS.therm_pin);
+	//Let the line recover before the next slot
+	therm_delay(DS.t_write_rec);
 }
 
 uint8_t therm_read_n_times(uint8_t n, uint8_t threshold)
 {
-	uint8_t val;
+	uint8_t val = 0;
 	while(n--)
 	{
-		val += READ_PIN(THERM_PIN, DS.therm_pin);
-		//val += (THERM_PIN & (1 << DS.therm_pin));
+		//count high samples (writing PINx would toggle the port bit)
+		if (HAL_BUS_READ(DS.therm_pin))
+			val++;
 	}
 	return (val >= threshold);
 }
@@ -103,24 +328,24 @@ uint8_t therm_read_bit(void)
 {	
 	uint8_t bit = 0;
 	
-	PIN_LOW(TRIG_PORT,TRIG_READ_PIN);
+	HAL_TRIG_LOW(TRIG_READ_PIN);
 	
-	//Pull line low for 1uS
-	THERM_LOW(THERM_PORT, DS.therm_pin);
-	THERM_OUTPUT_MODE(THERM_DDR, DS.therm_pin);
-	//Release line and wait for 14uS
-	THERM_INPUT_MODE(THERM_DDR, DS.therm_pin);
+	//Pull line low for 6uS
+	HAL_BUS_LOW(DS.therm_pin);
+	therm_delay(DS.t_write_low);
+	//Release line and wait for 9uS
+	HAL_BUS_RELEASE(DS.therm_pin);
 	therm_delay(DS.t_read_samp);
 	
-	PIN_HIGH(TRIG_PORT,TRIG_READ_PIN);
-	if (THERM_PIN & (1 << DS.therm_pin))
+	HAL_TRIG_HIGH(TRIG_READ_PIN);
+	if (HAL_BUS_READ(DS.therm_pin))
 		bit = 1;
-	PIN_LOW(TRIG_PORT,TRIG_READ_PIN);
+	HAL_TRIG_LOW(TRIG_READ_PIN);
+	TRACE(TRACE_EV_SAMPLE, bit);
 	
-	//bit = therm_read_n_times(1,0);	
-	//Wait for 45uS to end and return read value
+	//Wait for 55uS to end and return read value
 	therm_delay(DS.t_read_slot);
-	PIN_HIGH(TRIG_PORT,TRIG_READ_PIN);
+	HAL_TRIG_HIGH(TRIG_READ_PIN);
 	
 	return bit;
 }
@@ -128,107 +353,227 @@ uint8_t therm_read_bit(void)
 uint8_t therm_read_byte(void)
 {
 	uint8_t i = 8, n = 0;
-	cli();
-	PIN_LOW(TRIG_PORT,TRIG_BYTE_PIN);
+	CRITICAL_SECTION_START;
+	HAL_TRIG_LOW(TRIG_BYTE_PIN);
 	while (i--)
 	{
 		//Shift one position right and store read value
 		n >>= 1;
 		n |= (therm_read_bit() << 7);
 	}
-	PIN_HIGH(TRIG_PORT,TRIG_BYTE_PIN);
-	sei();
+	HAL_TRIG_HIGH(TRIG_BYTE_PIN);
+	TRACE(TRACE_EV_READ, n);
+	CRITICAL_SECTION_END;
+	ThermStats[DS.therm_pin].bytes++;
+	ThermStatLast = hal_ticks();
 	return n;
 }
 
 void therm_write_byte(uint8_t byte)
 {
 	uint8_t i = 8;
-	cli();
+	CRITICAL_SECTION_START;
+	TRACE(TRACE_EV_WRITE, byte);
 	while (i--)
 	{
 		//Write actual bit and shift one position right to make the next bit ready
 		therm_write_bit(byte & 1);
 		byte >>= 1;
 	}
-	sei();
+	CRITICAL_SECTION_END;
+	ThermStats[DS.therm_pin].bytes++;
+	ThermStatLast = hal_ticks();
 }
 
 /////////////////////////////////////////////////////////////////////////
 void therm_print_scratchpad()
 {
 	uint8_t i;
-	rprintfStr("[");
+	rprintfChar('[');
 	for (i = 0; i < 9; i++)
 	{
-		rprintfNum(10, 3, 0, ' ', DS.scratchpad[i]);
+		rprintfDecU16(DS.scratchpad[i], 3, ' ');
 		if (i !=8)
-			rprintfStr(",");
+			rprintfChar(',');
 	}
-	rprintfStr("]");
+	rprintfChar(']');
 }
 
 void therm_print_devID()
 {
 	uint8_t i;
-	rprintfStr("\"");
+	rprintfChar('"');
 	for (i = 0; i < 8; i++)
 	{
-		rprintf("%d",DS.devID[i]);
+		rprintfDecU16(DS.devID[i], 0, 0);
 		if (i==7)
-			rprintf("\"");
+			rprintfChar('"');
 		else
-			rprintf(".");
+			rprintfChar('.');
 	}
 }
 
-void therm_print_timing()
+void therm_print_timing(uint8_t speed)
 {
-	rprintf("\n1Wire Timing\n");
-	rprintf("01 t_conv       : %d\n",DS.t_conv);
-	rprintf("02 t_reset_tx   : %d\n",DS.t_reset_tx);
-	rprintf("03 t_reset_rx   : %d\n",DS.t_reset_rx);
-	rprintf("04 t_reset_delay: %d\n",DS.t_reset_delay);	
-	rprintf("05 t_write_low  : %d\n",DS.t_write_low);
-	rprintf("06 t_write_slot : %d\n",DS.t_write_slot);
-	rprintf("07 t_read_samp  : %d\n",DS.t_read_samp);
-	rprintf("08 t_read_slot  : %d\n",DS.t_read_slot);
+	Timing_t *t = &eeprom.timing[DS.therm_pin][speed];
+	if (speed == THERM_SPEED_OD)
+		rprintf("\n1Wire Overdrive Timing (us), pin %d\n", DS.therm_pin);
+	else
+		rprintf("\n1Wire Timing (us), pin %d\n", DS.therm_pin);
+	rprintf("01 t_conv (ms)  : %d\n",eeprom_read_word(&eeprom.t_conv));
+	rprintf("02 t_reset_tx   : %d\n",eeprom_read_word(&t->t_reset_tx));
+	rprintf("03 t_reset_rx   : %d\n",eeprom_read_word(&t->t_reset_rx));
+	rprintf("04 t_reset_delay: %d\n",eeprom_read_word(&t->t_reset_delay));
+	rprintf("05 t_write_low  : %d\n",eeprom_read_byte(&t->t_write_low));
+	rprintf("06 t_write_slot : %d\n",eeprom_read_byte(&t->t_write_slot));
+	rprintf("07 t_read_samp  : %d\n",eeprom_read_byte(&t->t_read_samp));
+	rprintf("08 t_read_slot  : %d\n",eeprom_read_byte(&t->t_read_slot));
+	rprintf("09 t_write_rec  : %d\n",eeprom_read_byte(&t->t_write_rec));
 }
 
-void therm_set_timing(uint8_t time, uint16_t interval)
+void therm_set_timing(uint8_t speed, uint8_t time, uint16_t interval)
 {
-	cli();
+	Timing_t *t = &eeprom.timing[DS.therm_pin][speed];
+	CRITICAL_SECTION_START;
 	switch (time)
 	{
 	case 1:
 		eeprom_write_word(&eeprom.t_conv, interval);
 		break;
 	case 2:
-		eeprom_write_word(&eeprom.t_reset_tx, interval);
+		eeprom_write_word(&t->t_reset_tx, interval);
 		break;
 	case 3:
-		eeprom_write_word(&eeprom.t_reset_rx, interval);
+		eeprom_write_word(&t->t_reset_rx, interval);
 		break;
 	case 4:
-		eeprom_write_word(&eeprom.t_reset_delay, interval);
+		eeprom_write_word(&t->t_reset_delay, interval);
 		break;
 	case 5:
-		eeprom_write_byte(&eeprom.t_write_low, interval);
+		eeprom_write_byte(&t->t_write_low, interval);
 		break;
 	case 6:
-		eeprom_write_byte(&eeprom.t_write_slot, interval);
+		eeprom_write_byte(&t->t_write_slot, interval);
 		break;
 	case 7:
-		eeprom_write_byte(&eeprom.t_read_samp, interval);
+		eeprom_write_byte(&t->t_read_samp, interval);
 		break;
 	case 8:
-		eeprom_write_byte(&eeprom.t_read_slot, interval);
+		eeprom_write_byte(&t->t_read_slot, interval);
+		break;
+	case 9:
+		eeprom_write_byte(&t->t_write_rec, interval);
 		break;
 	default:
 		break;
 	}
-	therm_init();
-	sei();
+	// reload without therm_init() so the pin and devID survive
+	DS.t_conv = eeprom_read_word(&eeprom.t_conv);
+	therm_set_speed(DS.speed);
+	CRITICAL_SECTION_END;
+}
+
+//////////////////////////////////////////////////////////////
+// Timing tuner
+//
+// sweep ranges in us for the standard speed entries, {entry, first, last}
+static const uint8_t PROGMEM therm_tune_range[THERM_TUNE_PARAMS][3] =
+{
+		{4, 30, 120}, // t_reset_delay
+		{5,  1,  15}, // t_write_low
+		{7,  1,  30}, // t_read_samp
+};
+
+// one bus transaction, passes on presence and a good CRC
+static uint8_t therm_tune_trial(void)
+{
+	uint8_t i, n, any = 0, crc[1];
+
+	if (therm_reset())
+		return 0;
+	if (DS.devID[0])
+	{
+		// standard Match ROM: overdrive would reload the profile under test
+		therm_write_byte(THERM_CMD_MATCHROM);
+		for (i = 0; i < 8; i++)
+			therm_write_byte(DS.devID[i]);
+		therm_write_byte(THERM_CMD_RSCRATCHPAD);
+		n = 9;
+	}
+	else
+	{
+		therm_write_byte(THERM_CMD_READROM);
+		n = 8;
+	}
+	for (i = 0; i < n; i++)
+		any |= (DS.scratchpad[i] = therm_read_byte());
+	// an all zero read (bus held low) has a valid CRC too
+	crc[0] = 0;
+	return any && therm_crc_is_OK(DS.scratchpad, crc, n - 1);
+}
+
+static uint16_t *therm_tune_field(uint8_t time)
+{
+	if (time == 4)
+		return &DS.t_reset_delay;
+	if (time == 5)
+		return &DS.t_write_low;
+	return &DS.t_read_samp;
+}
+
+void therm_tune(uint8_t trials, uint8_t window[][3])
+{
+	uint8_t p, us, t, ok, need, last, run_lo = 0, run_len, best_len;
+	uint16_t *field;
+
+	// a step passes when THERM_TUNE_PASS % of its trials read a good CRC
+	need = (uint16_t) trials * THERM_TUNE_PASS / 100;
+	if (need == 0)
+		need = 1;
+	therm_set_speed(THERM_SPEED_STD);
+	// first registered device on this pin that reads with the stored timing
+	// (a DS2438 needs a page number, skip it), a single drop bus otherwise
+	for (p = 0; p < THERM_REGISTRY_SIZE; p++)
+		if (therm_load_devID(p) && DS.devID[0] != DS2438 && therm_tune_trial())
+			break;
+	if (p == THERM_REGISTRY_SIZE)
+		DS.devID[0] = 0;
+
+	for (p = 0; p < THERM_TUNE_PARAMS; p++)
+	{
+		window[p][0] = pgm_read_byte(&therm_tune_range[p][0]);
+		window[p][1] = 0;
+		window[p][2] = 0;
+		field    = therm_tune_field(window[p][0]);
+		last     = pgm_read_byte(&therm_tune_range[p][2]);
+		run_len  = 0;
+		best_len = 0;
+		for (us = pgm_read_byte(&therm_tune_range[p][1]); us <= last; us++)
+		{
+			*field = therm_us_to_loops(us);
+			// stop early once the step cannot pass any more
+			for (t = ok = 0; t < trials && ok + trials - t >= need; t++)
+				ok += therm_tune_trial();
+			if (ok < need)
+			{
+				run_len = 0;
+				continue;
+			}
+			if (run_len++ == 0)
+				run_lo = us;
+			if (run_len > best_len)
+			{
+				best_len = run_len;
+				window[p][1] = run_lo;
+				window[p][2] = us;
+			}
+		}
+		// keep the stored value when nothing passed, else take the centre
+		if (best_len)
+			therm_set_timing(THERM_SPEED_STD, window[p][0], (window[p][1] + window[p][2]) / 2);
+		else
+			therm_set_speed(THERM_SPEED_STD);
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -245,25 +590,48 @@ uint8_t therm_load_devID(uint8_t devNum){
 	{
 		no_error = therm_crc_is_OK(DS.devID, crc, 7);		
 	}
+	DS.od_capable = therm_get_overdrive(devNum);
 	//rprintf("therm_load_devID() no_error = %d\n",no_error);	
 	return no_error;
 }
 
 void therm_save_devID(uint8_t devNum){
 	uint8_t i;
-	cli();
+	CRITICAL_SECTION_START;
 	for (i = 0; i < 8; i++){
 		//eeprom_write_byte(&eeprom.dev[devNum][i], DS.devID[i]);
 		eeprom_write_byte(&eeprom.rom[DS.therm_pin][devNum][i], DS.devID[i]);
 	}
-	sei();
+	CRITICAL_SECTION_END;
+	DS.od_capable = therm_supports_overdrive(DS.devID[0]);
+	therm_set_overdrive(devNum, DS.od_capable);
+}
+
+uint8_t therm_get_interval(uint8_t devNum)
+{
+	uint8_t periods = eeprom_read_byte(&eeprom.interval[DS.therm_pin][devNum]);
+	if (periods == 0 || periods == 0xff)
+		periods = 1;
+	return periods;
+}
+
+void therm_set_interval(uint8_t devNum, uint8_t periods)
+{
+	if (devNum < THERM_REGISTRY_SIZE)
+		eeprom_write_byte(&eeprom.interval[DS.therm_pin][devNum], periods);
 }
 
 void therm_set_devID(uint8_t *devID){
 	uint8_t i;
-	for (i = 0; i < 9; i++){
+	for (i = 0; i < 8; i++){
 		DS.devID[i] = devID[i];		
 	}
+	// a ROM outside the registry goes by its family code
+	DS.od_capable = therm_supports_overdrive(devID[0]);
+}
+
+uint8_t *therm_get_devID(void){
+	return DS.devID;
 }
 
 void therm_send_devID(){
@@ -272,6 +640,15 @@ void therm_send_devID(){
 	{
 		therm_write_byte(THERM_CMD_SKIPROM);
 	}
+	else if (DS.od_enable && DS.od_capable)
+	{
+		// the command goes out at standard speed, the ROM and the rest of
+		// the transaction at overdrive speed (until the next therm_reset)
+		therm_write_byte(THERM_CMD_OD_MATCHROM);
+		therm_set_speed(THERM_SPEED_OD);
+		for (i = 0; i < 8; i++)
+			therm_write_byte(DS.devID[i]);
+	}
 	else
 	{
 		therm_write_byte(THERM_CMD_MATCHROM);
@@ -280,11 +657,13 @@ void therm_send_devID(){
 	}
 }
 
-uint8_t therm_read_devID(){
+static uint8_t therm_read_devID_once(void){
 	uint8_t no_error = 0, i = 0, crc[1];
 	crc[0] = 0;
 
-	therm_reset();
+	// nobody answered, do not wait for 8 bytes of ones
+	if (therm_reset())
+		return 0;
 	//therm_send_devID();
 	therm_write_byte(THERM_CMD_SKIPROM);
 	therm_reset();
@@ -292,11 +671,24 @@ uint8_t therm_read_devID(){
 	for (i = 0; i < 8; i++)
 		DS.devID[i] = therm_read_byte();
 
-	no_error = therm_crc_is_OK(DS.devID, crc, 7);
+	no_error = therm_stat_crc(therm_crc_is_OK(DS.devID, crc, 7));
+
+	return no_error;
+}
 
+uint8_t therm_read_devID(){
+	uint8_t attempt = 0, no_error;
+	while (!(no_error = therm_read_devID_once()) && therm_retry(THERM_TX_ROM, &attempt));
 	return no_error;
 }
 
+void therm_overdrive_skip(void)
+{
+	// all overdrive capable devices switch to overdrive, others go idle
+	therm_write_byte(THERM_CMD_OD_SKIPROM);
+	therm_set_speed(THERM_SPEED_OD);
+}
+
 void therm_start_measurement(){
 	therm_write_byte(THERM_CMD_SKIPROM);
 	therm_write_byte(THERM_CMD_CONVERTTEMP);
@@ -309,7 +701,7 @@ uint8_t therm_read_scratchpad(uint8_t numOfbytes){
 	for (i = 0; i < numOfbytes; i++)
 		DS.scratchpad[i] = therm_read_byte();
 	crc[0] = 0;
-	no_error = therm_crc_is_OK(DS.scratchpad, crc, numOfbytes - 1);
+	no_error = therm_stat_crc(therm_crc_is_OK(DS.scratchpad, crc, numOfbytes - 1));
 	return no_error;
 }
 
@@ -322,7 +714,7 @@ uint8_t therm_read_temperature(uint8_t devNum, int16_t *temperature)
 	{
 		therm_reset();
 		therm_start_measurement();
-		_delay_ms(200);
+		hal_delay_ms(DS.t_conv);
 		therm_reset();
 		no_error = therm_read_scratchpad(9);
 		//therm_print_scratchpad(s);rprintfCRLF();
@@ -345,85 +737,62 @@ uint8_t therm_read_temperature(uint8_t devNum, int16_t *temperature)
 }
 
 uint8_t therm_read_result(int16_t *temperature){
-	uint8_t no_error = 1;
+	uint8_t status = therm_read_temp(temperature);
+	rprintfFixed4(temperature[0], temperature[1]);
+	return status;
+}
+
+static uint8_t therm_read_temp_once(int16_t *temperature){
+	uint8_t no_error = 0;
+	int16_t raw;
 	temperature[0] = 999;
 	temperature[1] = 9999;
 
-	therm_reset();
+	// a family without a temperature is a setup error, not a bus failure
+	if (DS.devID[0] != DS18S20 && DS.devID[0] != DS18B20 &&
+			DS.devID[0] != DS28EA00 && DS.devID[0] != DS2438)
+		return THERM_READ_UNSUPPORTED;
 
-	if (no_error)
-	{
-		if(DS.devID[0] == DS18S20)
-		{
-			no_error = therm_read_scratchpad(9);
-			//temperature[0] = (int16_t) (((DS.scratchpad[1] << 8) | (DS.scratchpad[0])) >> 1);
-				temperature[0] = ((int16_t)((DS.scratchpad[1]<<8) | DS.scratchpad[0]));
-				if (DS.scratchpad[1] == 255)
-				{
-					temperature[0] = (temperature[0] >> 1);
-					if (DS.scratchpad[6] >= 12)
-					{
-						temperature[1] = (int16_t) (DS.scratchpad[6] * 625) - (int16_t) (7500);
-					}
-					else
-					{
-						temperature[0] += 1;
-						temperature[1] = (int16_t) (2500) + (int16_t) (DS.scratchpad[6] * 625);
-						if(temperature[0] == 0)
-							rprintf("-");
-					}
-				}
-				else
-				{
-					temperature[0] = (temperature[0] >> 1);
-					if (DS.scratchpad[6] > 12)
-					{
-						temperature[0] -= 1;
-						if(DS.scratchpad[0] == 0)
-						{
-							temperature[1] = (DS.scratchpad[6]) * 625 - 7500;
-							temperature[0] = 0;
-							if (DS.scratchpad[6] > 12)
-								rprintf("-");
-						}
-//						else if ((DS.scratchpad[0] == 2) & (DS.scratchpad[6] == 12))
-//							temperature[0] += 1;
-						else
-							temperature[1] = (int16_t) (17500) - (int16_t) (DS.scratchpad[6] * 625);
-					}
-					else
-						temperature[1] = (int16_t) (7500) - (int16_t) (DS.scratchpad[6] * 625);
-				}
-			}
-			else if(DS.devID[0] == DS18B20)
-				{
-					no_error = therm_read_scratchpad(9);
-					temperature[0] = (int16_t) (((DS.scratchpad[1] << 8) | (DS.scratchpad[0])) >> 4);
-					temperature[1] = (int16_t) (((DS.scratchpad[1] << 8) | (DS.scratchpad[0])) & 15)*THERM_DECIMAL_STEPS_12BIT;
-				}
-			else if (DS.devID[0] == DS2438)
-			{
-				if (get_ds2438_temperature())
-				{
-					temperature[0] = (int16_t) (DS.scratchpad[2]);
-					temperature[1] = (int16_t) (DS.scratchpad[1]);
-				}
-			}
+	// nobody answered, do not wait for a scratchpad of ones
+	if (therm_reset())
+		return THERM_READ_FAILED;
 
-			else
-				{
-					rprintf("\"DEV_NOT_FOUND\"");
-				}
+	if(DS.devID[0] == DS18S20)
+	{
+		no_error = therm_read_scratchpad(9);
+		// extended resolution in 1/16 C:
+		// T = TEMP_READ (bit 0 truncated) - 0.25 + (COUNT_PER_C - COUNT_REMAIN) / 16
+		raw = (int16_t) ((DS.scratchpad[1] << 8) | DS.scratchpad[0]);
+		raw = (raw >> 1) * 16 + 12 - (int16_t) DS.scratchpad[6];
+	}
+	else if(DS.devID[0] == DS18B20 || DS.devID[0] == DS28EA00)
+	{
+		no_error = therm_read_scratchpad(9);
+		raw = (int16_t) ((DS.scratchpad[1] << 8) | DS.scratchpad[0]);
+	}
+	else if (DS.devID[0] == DS2438)
+	{
+		no_error = get_ds2438_temperature();
+		// 1/256 C with the 3 low bits unused, keep 1/16 C resolution (rounded down)
+		raw = (int16_t) ((DS.scratchpad[2] << 8) | DS.scratchpad[1]) >> 4;
 	}
-	else
-		//rprintf("CRC ERROR");
-		;
 
-	rprintf("%d.",temperature[0]);
-	rprintfNum(10, 4, 0, '0', temperature[1]);
+	if (no_error)
+	{
+		// integer part is the floor, fraction in 1/10000 C
+		temperature[0] = raw >> 4;
+		temperature[1] = (raw & 15) * THERM_DECIMAL_STEPS_12BIT;
+	}
 	return no_error;
 }
 
+uint8_t therm_read_temp(int16_t *temperature){
+	uint8_t attempt = 0, status;
+	while ((status = therm_read_temp_once(temperature)) == THERM_READ_FAILED &&
+			therm_retry(THERM_TX_TEMP, &attempt));
+	return status;
+}
+
 uint8_t therm_computeCRC8(uint8_t inData, uint8_t seed)
 {
 	uint8_t bitsLeft;
@@ -452,45 +821,56 @@ uint8_t therm_crc_is_OK(uint8_t *scratchpad, uint8_t *crc, uint8_t numOfBytes)
 	uint8_t i = 0, id_sum=0;
 	crc[0] = 0;
 	for (i = 0; i < numOfBytes; i++)
+	{
 		crc[0]  = therm_computeCRC8(scratchpad[i], crc[0]);
-		id_sum += scratchpad[i];	
+		id_sum += scratchpad[i];
+	}
 	return ((scratchpad[numOfBytes] == crc[0]) && (id_sum > 0));
 }
 
 //////////////////////////////////////////////////////////////
 // DS2438
 //
-void recal_memory_page(uint8_t page)
+static uint8_t recal_memory_page_once(uint8_t page)
 {
 	uint8_t i = 0, crc[1],no_error, numOfbytes = 9;
-	therm_reset();
+	if (therm_reset())
+		return 0;
 	therm_write_byte(THERM_CMD_SKIPROM);
-	_delay_ms(1);
+	hal_delay_ms(1);
 	therm_write_byte(0xb8);
 	therm_write_byte(page);
 
 	therm_reset();
 	therm_write_byte(THERM_CMD_SKIPROM);
-	_delay_ms(1);
+	hal_delay_ms(1);
 	therm_write_byte(0xbe);
 	therm_write_byte(page);
 	for (i = 0; i < 9; i++)
 		DS.scratchpad[i] = therm_read_byte();
-		crc[0] = 0;
-	no_error = therm_crc_is_OK(DS.scratchpad, crc, numOfbytes - 1);
+	crc[0] = 0;
+	no_error = therm_stat_crc(therm_crc_is_OK(DS.scratchpad, crc, numOfbytes - 1));
+	return no_error;
+}
+
+uint8_t recal_memory_page(uint8_t page)
+{
+	uint8_t attempt = 0, no_error;
+	while (!(no_error = recal_memory_page_once(page)) && therm_retry(THERM_TX_PAGE, &attempt));
+	return no_error;
 }
 void test_ds2438()
 {
 	therm_reset();
 	therm_write_byte(THERM_CMD_SKIPROM);
 	therm_write_byte(THERM_CMD_CONVERTTEMP);
-	_delay_ms(25);
+	hal_delay_ms(25);
 
 	therm_reset();
 	therm_write_byte(THERM_CMD_SKIPROM);
 	therm_write_byte(THERM_CMD_CONVERT_VOLTAGE);
 
-	_delay_ms(25);
+	hal_delay_ms(25);
 
 	recal_memory_page(0);
 	therm_print_scratchpad();
@@ -506,19 +886,19 @@ uint8_t get_ds2438_temperature(void)
 		therm_reset();
 		therm_send_devID();
 
-		_delay_ms(1);
+		hal_delay_ms(1);
 		therm_write_byte(0xb8);
 		therm_write_byte(0);
 
 		therm_reset();
 		therm_send_devID();
-		_delay_ms(1);
+		hal_delay_ms(1);
 		therm_write_byte(0xbe);
 		therm_write_byte(0);
 		for (i = 0; i < numOfbytes; i++)
 			DS.scratchpad[i] = therm_read_byte();
 		crc[0] = 0;
-		no_error = therm_crc_is_OK(DS.scratchpad, crc, numOfbytes - 1);
+		no_error = therm_stat_crc(therm_crc_is_OK(DS.scratchpad, crc, numOfbytes - 1));
 	}
 	return no_error;
 }
@@ -608,8 +988,8 @@ uint8_t OWSearch()
    if (!LastDeviceFlag)
    {
 	  // rprintf("\nLastDeviceFlag = 0\n");	
-      // 1-Wire reset
-      if (therm_reset()==0)
+      // 1-Wire reset (non-zero means no presence pulse)
+      if (therm_reset())
       {
 		 rprintf("therm_reset()\n");	
          // reset the search
@@ -693,6 +1073,9 @@ uint8_t OWSearch()
 	  // end of do-while loop 
 	  /////////////////////////////////////////////////////////////////////////////////
 	  
+      if ((id_bit_number == 65) && (crc8 != 0))
+         therm_stat_crc(0);
+
       // if the search was successful then
       if (!((id_bit_number < 65) || (crc8 != 0)))
       {
@@ -771,19 +1154,20 @@ void therm_test_func(void)
 {
 	uint8_t i;
 	//rprintf("therm_test_func()\n");
+		rprintfChar('"');
 		for (i = 0; i < 8; i++)
 		{
-			rprintf("%d",ROM_NO[i]);
+			rprintfDecU16(ROM_NO[i], 0, 0);
 			if (i==7)
-				rprintf("\"");
+				rprintfChar('"');
 			else
-				rprintf(".");
+				rprintfChar('.');
 		}
 	rprintfCRLF();
 }
 
 // TEST BUILD
-static unsigned char dscrc_table[] = {
+static const unsigned char PROGMEM dscrc_table[] = {
         0, 94,188,226, 97, 63,221,131,194,156,126, 32,163,253, 31, 65,
       157,195, 33,127,252,162, 64, 30, 95,  1,227,189, 62, 96,130,220,
        35,125,159,193, 66, 28,254,160,225,191, 93,  3,128,222, 60, 98,
@@ -810,6 +1194,6 @@ unsigned char docrc8(unsigned char value)
 {
    // See Application Note 27
    // TEST BUILD
-   crc8 = dscrc_table[crc8 ^ value];
+   crc8 = pgm_read_byte(&dscrc_table[crc8 ^ value]);
    return crc8;
 }
@@ -1,13 +1,18 @@
-#include <avr/io.h>
 #include <stdio.h>
+#include "hal.h"
 #include "rprintf.h"
 
 #ifndef F_CPU
 #define F_CPU 16000000UL 		//Your clock speed in Hz (3Mhz here)
 #endif
 
-#define LOOP_CYCLES 16		//Number of cycles that the loop takes
-#define us(num) (num/(LOOP_CYCLES*(1/(F_CPU/1000000.0))))
+// therm_delay() runs hal_delay_loops(), which takes exactly 4 cycles per loop
+#define THERM_LOOPS_PER_US   (F_CPU/4000000UL)
+// cost of loading the count, the therm_delay() call, zero check and return
+// (about 14 cycles), in loops
+#define THERM_DELAY_OVERHEAD 3
+// longest delay that fits the 16-bit loop counter
+#define THERM_MAX_DELAY_US   (65535UL/THERM_LOOPS_PER_US)
 
 /* list of these commands translated into C defines:*/
 #define THERM_CMD_CONVERTTEMP 0x44
@@ -23,6 +28,8 @@
 #define THERM_CMD_MATCHROM 0x55
 #define THERM_CMD_SKIPROM 0xcc
 #define THERM_CMD_ALARMSEARCH 0xec
+#define THERM_CMD_OD_SKIPROM  0x3c
+#define THERM_CMD_OD_MATCHROM 0x69
 /* constants */
 #define THERM_DECIMAL_STEPS_12BIT 625 //.0625
 
@@ -30,7 +37,7 @@
 // GENERIC MACROS
 #define PIN_LOW(reg,  bit)  reg &=~(1<<bit)
 #define PIN_HIGH(reg, bit)  reg |= (1<<bit)
-#define READ_PIN(reg, bit)  reg &= (1<<bit)
+#define READ_PIN(reg, bit)  (reg & (1<<bit))
 #define TOGGLE(reg,bit)     reg ^= (_BV(bit))
 
 #define THERM_PORT PORTB
@@ -38,30 +45,43 @@
 #define THERM_PIN  PINB
 #define THERM_DQ   PINB0
 
-#define TRIG_PORT  PORTC
-#define TRIG_DDR   DDRC
-#define TRIG_RESET_PIN PINC0
-#define TRIG_READ_PIN  PINC1
-#define TRIG_BYTE_PIN  PINC2 
+// debug trigger pins, driven through HAL_TRIG_LOW/HIGH (PORTC on the AVR)
+#define TRIG_RESET_PIN 0
+#define TRIG_READ_PIN  1
+#define TRIG_BYTE_PIN  2
 
 #define DS2438     38
 #define DS18B20    40
 #define DS18S20    16
+#define DS28EA00   66	// DS18B20 scratchpad, overdrive capable
 
-/* Utils */
-#define THERM_INPUT_MODE(reg, bit)  reg &=~ (1<<bit)
-#define THERM_OUTPUT_MODE(reg, bit) reg |=  (1<<bit)
-#define THERM_LOW(reg, bit)  reg &=~(1<<bit)
-#define THERM_HIGH(reg, bit) reg |=(1<<bit)
+/* bus speed, index of the timing profile in eeprom */
+#define THERM_SPEED_STD 0
+#define THERM_SPEED_OD  1
+#define THERM_NUM_SPEEDS 2
 
-#define TRIG_LOW(bit)  TRIG_PORT&=~(1<<TRIG_PIN)
-#define TRIG_HIGH(bit) TRIG_PORT|=(1<<TRIG_PIN)
+/* bus owners, see therm_bus_acquire() */
+#define THERM_BUS_FREE   0
+#define THERM_BUS_SHELL  1
+#define THERM_BUS_STREAM 2
+
+/* ROM registry slots per bus */
+#define THERM_REGISTRY_SIZE 20
+
+/* number of buses (PORTB pins), each with its own timing and ROM registry */
+#define THERM_NUM_PINS 4
+
+/* timing tuner: default trials per step, number of swept entries and the
+   share of trials (%) that must pass the CRC check for a step to pass */
+#define THERM_TUNE_TRIALS 8
+#define THERM_TUNE_PARAMS 3
+#define THERM_TUNE_PASS   90
 
 //#define THERM_DEBUG 1
 
+// bit timing profile in microseconds
 typedef struct
 {
-	uint16_t t_conv;
 	uint16_t t_reset_tx;
 	uint16_t t_reset_rx;
 	uint16_t t_reset_delay;
@@ -69,9 +89,22 @@ typedef struct
 	uint8_t  t_write_slot;
 	uint8_t  t_read_samp;
 	uint8_t  t_read_slot;
-	uint8_t  dev[20][8];
-	uint8_t  rom[4][20][8];
-	
+	uint8_t  t_write_rec;
+} Timing_t;
+
+// eeprom layout, one timing profile per bus and speed (t_conv in milliseconds);
+// interval is the streaming period of each registry slot in multiples of
+// the stream interval, 0 or 0xff (erased) stream every interval.
+// The ROM registry sits behind the timing tables, so ROMs stored by firmware
+// without them are not found after an upgrade: run search (or save) again.
+// od holds one bit per registry slot, set for devices addressed at overdrive.
+typedef struct
+{
+	uint16_t t_conv;
+	Timing_t timing[THERM_NUM_PINS][THERM_NUM_SPEEDS];
+	uint8_t  rom[THERM_NUM_PINS][THERM_REGISTRY_SIZE][8];
+	uint8_t  interval[THERM_NUM_PINS][THERM_REGISTRY_SIZE];
+	uint32_t od[THERM_NUM_PINS];
 } EE_RAM_t;
 
 typedef struct
@@ -79,6 +112,30 @@ typedef struct
 	uint8_t  num;	
 } EE_ROM_t;
 
+// retry policy per transaction type, see therm_set_retry()
+#define THERM_TX_TEMP	0	// temperature scratchpad read
+#define THERM_TX_ROM	1	// READ ROM
+#define THERM_TX_PAGE	2	// DS2438 page recall and read
+#define THERM_TX_TYPES	3
+
+typedef struct
+{
+	uint8_t retries;		// repeats of a failed transaction
+	uint8_t recover_ms;		// idle bus time and extra reset before a repeat, 0 = none
+} ThermRetry_t;
+
+// running bus statistics, one set per pin
+typedef struct
+{
+	uint16_t transactions;	// reset pulses
+	uint32_t bytes;			// bytes read and written
+	uint16_t crc_errors;	// bad CRC on scratchpad, ROM and search reads
+	uint16_t presence_fail;	// resets without a presence pulse
+	uint16_t retries;		// repeated reads after an error
+	uint16_t t_max_us;		// longest transaction, reset to last byte
+	uint32_t t_sum_us;		// for the average transaction time
+} ThermStats_t;
+
 typedef struct
 {
 	uint8_t  scratchpad[9];
@@ -86,14 +143,20 @@ typedef struct
 	int8_t   temp_digit;
 	int16_t  temp_decimal;
 	uint8_t  therm_pin;
+	uint8_t  speed;      // THERM_SPEED_STD or THERM_SPEED_OD
+	uint8_t  od_enable;  // address overdrive capable devices at overdrive speed
+	uint8_t  od_capable; // the selected device (devID) supports overdrive
 	uint16_t t_conv;
+	// bit timing of the current pin and speed in therm_delay() loops,
+	// converted from eeprom by therm_set_speed()
 	uint16_t t_reset_tx;
 	uint16_t t_reset_rx;
 	uint16_t t_reset_delay;
-	uint8_t  t_write_low;
-	uint8_t  t_write_slot;
-	uint8_t  t_read_samp;
-	uint8_t  t_read_slot;
+	uint16_t t_write_low;
+	uint16_t t_write_slot;
+	uint16_t t_read_samp;
+	uint16_t t_read_slot;
+	uint16_t t_write_rec;
 	
 	uint8_t ROM_NO[8];
 	uint8_t last_discrepancy;
@@ -103,7 +166,8 @@ typedef struct
 } DS_t;
 
 void    therm_init(void);
-void    therm_delay(uint16_t delay);
+void    therm_delay(uint16_t loops);
+uint16_t therm_us_to_loops(uint16_t us);
 uint8_t therm_reset();
 void    therm_write_bit(uint8_t bit);
 uint8_t therm_read_bit(void);
@@ -111,9 +175,35 @@ uint8_t therm_read_byte(void);
 void    therm_write_byte(uint8_t byte);
 void    therm_print_scratchpad();
 void    therm_print_devID();
-void    therm_print_timing();
-void    therm_set_timing(uint8_t time, uint16_t interval);
+void    therm_print_timing(uint8_t speed);
+void    therm_set_timing(uint8_t speed, uint8_t time, uint16_t interval);
 void    therm_set_pin(uint8_t newPin);
+void    therm_set_speed(uint8_t speed);
+void    therm_enable_overdrive(uint8_t enable);
+uint8_t therm_supports_overdrive(uint8_t family);
+// overdrive capability of a registry slot on the current pin; saving a ROM
+// sets it from the family code (therm_supports_overdrive)
+uint8_t therm_get_overdrive(uint8_t devNum);
+void    therm_set_overdrive(uint8_t devNum, uint8_t capable);
+void    therm_overdrive_skip(void);
+uint8_t therm_get_pin(void);
+// conversion time in ms (eeprom t_conv)
+uint16_t therm_get_conv_time(void);
+// bus ownership between the scheduler tasks; acquire returns 1 when the
+// bus is free or already held by <owner>
+uint8_t therm_bus_acquire(uint8_t owner);
+void    therm_bus_release(uint8_t owner);
+uint8_t therm_bus_owner(void);
+// a failed transaction (no presence or a bad CRC) of <type> is repeated up
+// to <retries> times, after <recover_ms> of idle bus and a reset when set
+void    therm_set_retry(uint8_t type, uint8_t retries, uint8_t recover_ms);
+ThermRetry_t *therm_get_retry(uint8_t type);
+// streaming period of a registry slot on the current pin, 1..254 intervals
+uint8_t therm_get_interval(uint8_t devNum);
+void    therm_set_interval(uint8_t devNum, uint8_t periods);
+ThermStats_t *therm_get_stats(uint8_t pin);
+void    therm_clear_stats(void);
+void    therm_tune(uint8_t trials, uint8_t window[][3]);
 void    therm_test_func(void);
 //
 uint8_t therm_read_n_times(uint8_t n, uint8_t threshold);
@@ -121,10 +211,18 @@ uint8_t therm_read_devID();
 void    therm_send_devID();
 uint8_t therm_load_devID(uint8_t devNum);
 void    therm_set_devID(uint8_t *devID);
+uint8_t *therm_get_devID(void);
 void    therm_save_devID(uint8_t devNum);
 uint8_t therm_read_scratchpad(uint8_t numOfbytes);
 void    therm_start_measurement();
+// temperature of the loaded device, printed; returns a THERM_READ_ status,
+// failures are retried (therm_set_retry), an unsupported family is not
+#define THERM_READ_FAILED		0
+#define THERM_READ_OK			1
+#define THERM_READ_UNSUPPORTED	2
 uint8_t therm_read_result(int16_t *temperature);
+// therm_read_result() without printing
+uint8_t therm_read_temp(int16_t *temperature);
 uint8_t therm_read_temperature(uint8_t devNum, int16_t *temperature);
 
 uint8_t therm_crc_is_OK(uint8_t *scratchpad, uint8_t *crc, uint8_t numOfBytes);
@@ -133,13 +231,16 @@ uint8_t therm_computeCRC8(uint8_t inData, uint8_t seed);
 //////////////////////////////////////////////////////////////
 // DS2438
 //
-void recal_memory_page(uint8_t page);
+uint8_t recal_memory_page(uint8_t page);
 void test_ds2438(void);
 void write_to_page(uint8_t page, uint8_t val);
 uint8_t get_ds2438_temperature(void);
 
 ////////////////////////////////////////////////////////////////
 // Search algorithm
+// the search code wants TRUE == 1 (avrlibdefs.h has -1)
+#undef  TRUE
+#undef  FALSE
 #define TRUE 1 //if !=0
 #define FALSE 0
 //
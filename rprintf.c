@@ -19,7 +19,6 @@
 //
 //*****************************************************************************
 
-#include <avr/pgmspace.h>
 //#include <string-avr.h>
 //#include <stdlib.h>
 #include <stdarg.h>
@@ -42,9 +41,12 @@
 //static char HexChars[] = "0123456789ABCDEF";
 // use this to store hex conversion in program memory
 //static prog_char HexChars[] = "0123456789ABCDEF";
-const static char __attribute__ ((progmem)) HexChars[] = "0123456789ABCDEF";
+static const char PROGMEM HexChars[] = "0123456789ABCDEF";
 
 #define hexchar(x)	pgm_read_byte( HexChars+((x)&0x0f) )
+
+// powers of ten used by the subtractive decimal conversion
+static const unsigned short PROGMEM DecPowers[] = {10000, 1000, 100, 10, 1};
 //#define hexchar(x)	((((x)&0x0F)>9)?((x)+'A'-10):((x)+'0'))
 
 // function pointer to single character output routine
@@ -257,6 +259,69 @@ void rprintfNum(char base, char numDigits, char isSigned, char padchar, long n)
 	}
 }
 
+// *** rprintfDecU16 ***
+// prints an unsigned 16-bit number in decimal, padded to numDigits
+void rprintfDecU16(unsigned short n, unsigned char numDigits, char padchar)
+{
+	unsigned char i, digit, started = 0;
+	unsigned short power;
+
+	for(i=0; i<5; i++)
+	{
+		// count how many times this power of ten fits
+		power = pgm_read_word(DecPowers+i);
+		digit = '0';
+		while(n >= power)
+		{
+			n -= power;
+			digit++;
+		}
+		// skip leading zeros (the last digit always prints)
+		if(started || (digit != '0') || (i == 4))
+		{
+			started = 1;
+			rprintfChar(digit);
+		}
+		else if((5-i) <= numDigits)
+		{
+			rprintfChar(padchar);
+		}
+	}
+}
+
+// *** rprintfDecS16 ***
+// prints a signed 16-bit number in decimal
+void rprintfDecS16(short n)
+{
+	if(n < 0)
+	{
+		rprintfChar('-');
+		n = -n;
+	}
+	rprintfDecU16((unsigned short)n, 0, 0);
+}
+
+// *** rprintfFixed4 ***
+// prints ipart + frac/10000 as [-]i.ffff
+void rprintfFixed4(short ipart, unsigned short frac)
+{
+	if(ipart < 0)
+	{
+		rprintfChar('-');
+		// ipart is the floor of the value, so borrow from it for the fraction
+		if(frac)
+		{
+			ipart = -(ipart+1);
+			frac = 10000 - frac;
+		}
+		else
+			ipart = -ipart;
+	}
+	rprintfDecU16((unsigned short)ipart, 0, 0);
+	rprintfChar('.');
+	rprintfDecU16(frac, 4, '0');
+}
+
 #ifdef RPRINTF_FLOAT
 // *** rprintfFloat ***
 // floating-point print
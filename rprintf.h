@@ -42,7 +42,7 @@
 #define RPRINTF_H
 
 // needed for use of PSTR below
-#include <avr/pgmspace.h>
+#include "hal.h"
 
 // configuration
 // defining RPRINTF_SIMPLE will compile a smaller, simpler, and faster printf() function
@@ -116,6 +116,34 @@ void rprintfu32(unsigned long data);	///< Print 32-bit hex number. Outputs eight
 /// \endcode
 void rprintfNum(char base, char numDigits, char isSigned, char padchar, long n);
 
+//! A fast unsigned 16-bit decimal printing routine.
+/// Prints "n" with at least "numDigits" digits, padded on the left with
+/// "padchar" (numDigits = 0 prints no padding), at most 5 positions.  Digits are found by repeated
+/// subtraction of powers of ten, avoiding the per-digit long division of
+/// rprintfNum().
+///
+///	Examples:
+/// \code
+/// rprintfDecU16(  42, 3, ' ');  -->  " 42"
+/// rprintfDecU16(1234, 5, '0');  -->  "01234"
+/// rprintfDecU16(1234, 0, 0  );  -->  "1234"
+/// \endcode
+void rprintfDecU16(unsigned short n, unsigned char numDigits, char padchar);
+
+//! Prints a signed 16-bit number in decimal ('-' for negative numbers only).
+void rprintfDecS16(short n);
+
+//! Prints a fixed-point value with four decimals.
+/// The value is "ipart" + "frac"/10000, with 0 <= frac < 10000 (ipart is the
+/// floor of the value, as produced by an arithmetic shift of sensor data).
+///
+///	Examples:
+/// \code
+/// rprintfFixed4(21, 625);   -->  "21.0625"
+/// rprintfFixed4(-1, 5000);  -->  "-0.5000"
+/// \endcode
+void rprintfFixed4(short ipart, unsigned short frac);
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 // JSON
 void json_sep(uint8_t i, uint8_t num_of_elements);
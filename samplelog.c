@@ -0,0 +1,111 @@
+/*
+ * samplelog.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * RAM sample log, see samplelog.h
+ */
+#include "global.h"
+#include "samplelog.h"
+
+#define SAMPLE_LOG_MASK		(SAMPLE_LOG_BYTES - 1)
+
+static uint8_t  SampleLog[SAMPLE_LOG_BYTES];
+static uint8_t  SampleHead;		// next byte to write
+static uint8_t  SampleTail;		// oldest byte
+static uint16_t SampleUsed;		// bytes held
+static uint8_t  SampleCount;	// readings held
+static uint16_t SampleDropped;
+static uint32_t SampleHeadTime;	// time of the last sweep header written
+static uint32_t SampleTailTime;	// time of the readings at the tail
+
+static void SampleLogByte(uint8_t b)
+{
+	SampleLog[SampleHead] = b;
+	SampleHead = (SampleHead + 1) & SAMPLE_LOG_MASK;
+	SampleUsed++;
+}
+
+// removes the oldest header or reading, returns 1 for a reading
+static uint8_t SampleLogPop(SampleRecord_t *rec)
+{
+	uint8_t i, slot = SampleLog[SampleTail];
+
+	if (slot == SAMPLE_LOG_TIME)
+	{
+		for (i = 4; i; i--)
+			SampleTailTime = (SampleTailTime << 8) | SampleLog[(SampleTail + i) & SAMPLE_LOG_MASK];
+		SampleTail = (SampleTail + 5) & SAMPLE_LOG_MASK;
+		SampleUsed -= 5;
+		return 0;
+	}
+	rec->time  = SampleTailTime;
+	rec->slot  = slot;
+	rec->value = SampleLog[(SampleTail + 1) & SAMPLE_LOG_MASK] |
+			SampleLog[(SampleTail + 2) & SAMPLE_LOG_MASK] << 8;
+	SampleTail = (SampleTail + 3) & SAMPLE_LOG_MASK;
+	SampleUsed -= 3;
+	SampleCount--;
+	return 1;
+}
+
+void sampleLogPut(uint32_t time, uint8_t slot, int16_t value)
+{
+	SampleRecord_t rec;
+	uint8_t header = (SampleUsed == 0 || time != SampleHeadTime);
+	uint8_t need = header ? 8 : 3;
+
+	// make room, oldest first
+	while (SAMPLE_LOG_BYTES - SampleUsed < need)
+		if (SampleLogPop(&rec) && SampleDropped < 0xffff)
+			SampleDropped++;
+	if (header)
+	{
+		SampleLogByte(SAMPLE_LOG_TIME);
+		SampleLogByte(time);
+		SampleLogByte(time >> 8);
+		SampleLogByte(time >> 16);
+		SampleLogByte(time >> 24);
+		SampleHeadTime = time;
+	}
+	SampleLogByte(slot);
+	SampleLogByte(value);
+	SampleLogByte(value >> 8);
+	SampleCount++;
+}
+
+uint8_t sampleLogGet(SampleRecord_t *rec)
+{
+	if (SampleCount == 0)
+		return 0;
+	while (!SampleLogPop(rec))
+		;
+	// a header left behind would only take room
+	if (SampleCount == 0)
+	{
+		SampleTail = SampleHead;
+		SampleUsed = 0;
+	}
+	return 1;
+}
+
+uint8_t sampleLogCount(void)
+{
+	return SampleCount;
+}
+
+uint16_t sampleLogDropped(void)
+{
+	uint16_t dropped = SampleDropped;
+	SampleDropped = 0;
+	return dropped;
+}
+
+void sampleLogClear(void)
+{
+	SampleHead    = 0;
+	SampleTail    = 0;
+	SampleUsed    = 0;
+	SampleCount   = 0;
+	SampleDropped = 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * samplelog.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * RAM log of streamed readings. In logging mode (stream 3) each sweep
+ * stores its readings here instead of printing them, and the "fetch"
+ * command uploads them in binary frames when the host is ready. When the
+ * log is full the oldest records are overwritten and counted as dropped.
+ * The readings of a sweep share one time: the log is a byte ring of sweep
+ * headers (SAMPLE_LOG_TIME, time) and readings (slot, value), 5 + 3 bytes
+ * per slot of the sweep, so a full registry sweep takes 65 bytes.
+ */
+
+#ifndef SAMPLELOG_H_
+#define SAMPLELOG_H_
+
+#include "global.h"
+
+// bytes held (power of two up to 256), almost 4 sweeps of every slot
+#define SAMPLE_LOG_BYTES	256
+
+typedef struct
+{
+	uint32_t time;		// conversion start, hal_millis()
+	uint8_t  slot;		// registry slot, SAMPLE_LOG_ERR on a read error
+	int16_t  value;		// 1/16 C
+} SampleRecord_t;
+
+#define SAMPLE_LOG_ERR		0x80
+#define SAMPLE_LOG_TIME		0x7f	// sweep header in the ring
+
+void     sampleLogPut(uint32_t time, uint8_t slot, int16_t value);
+// copies out the oldest reading with the time of its sweep, returns 0 when
+// the log is empty
+uint8_t  sampleLogGet(SampleRecord_t *rec);
+// readings held
+uint8_t  sampleLogCount(void);
+// readings overwritten since the last call
+uint16_t sampleLogDropped(void);
+void     sampleLogClear(void);
+
+#endif /* SAMPLELOG_H_ */
@@ -0,0 +1,102 @@
+/*
+ * sched.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Cooperative scheduler, see sched.h
+ */
+#include "global.h"
+#include "hal.h"
+#include "sched.h"
+
+typedef struct
+{
+	void     (*func)(void);
+	uint32_t due;
+	uint8_t  active;
+} Sched_t;
+
+static Sched_t SchedTasks[SCHED_MAX_TASKS];
+static uint8_t SchedCount;
+static volatile uint32_t SchedTicks;
+
+void schedTick(void)
+{
+	SchedTicks++;
+}
+
+uint32_t schedNow(void)
+{
+	uint32_t now;
+	CRITICAL_SECTION_START;
+	now = SchedTicks;
+	CRITICAL_SECTION_END;
+	return now;
+}
+
+SchedTask_t schedAdd(void (*func)(void))
+{
+	// like cmdlineAddCommand, extra tasks are ignored
+	if (SchedCount >= SCHED_MAX_TASKS)
+		return SCHED_NONE;
+	SchedTasks[SchedCount].func   = func;
+	SchedTasks[SchedCount].active = 0;
+	return SchedCount++;
+}
+
+void schedAt(SchedTask_t task, uint32_t tick)
+{
+	if (task >= SchedCount)
+		return;
+	SchedTasks[task].due    = tick;
+	SchedTasks[task].active = 1;
+}
+
+void schedIn(SchedTask_t task, uint16_t ticks)
+{
+	schedAt(task, schedNow() + ticks);
+}
+
+void schedStop(SchedTask_t task)
+{
+	if (task >= SchedCount)
+		return;
+	SchedTasks[task].active = 0;
+}
+
+uint8_t schedActive(SchedTask_t task)
+{
+	return task < SchedCount && SchedTasks[task].active;
+}
+
+uint8_t schedRunOnce(void)
+{
+	uint32_t now = schedNow();
+	int32_t late, latest = -1;
+	uint8_t i, next = SCHED_MAX_TASKS;
+
+	// earliest deadline among the due tasks, signed so the tick may wrap
+	for (i = 0; i < SchedCount; i++)
+	{
+		if (!SchedTasks[i].active)
+			continue;
+		late = (int32_t)(now - SchedTasks[i].due);
+		if (late > latest)
+		{
+			latest = late;
+			next = i;
+		}
+	}
+	if (next == SCHED_MAX_TASKS)
+		return 0;
+	// the task reschedules itself if it wants to run again
+	SchedTasks[next].active = 0;
+	SchedTasks[next].func();
+	return 1;
+}
+
+void schedRun(void)
+{
+	while (1)
+		schedRunOnce();
+}
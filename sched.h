@@ -0,0 +1,48 @@
+/*
+ * sched.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Cooperative scheduler for the main loop.
+ * A timer interrupt only advances the tick (schedTick); all work, bus
+ * transactions included, runs from schedRun() in the main context.
+ * A task is a function that runs to completion and then decides when it
+ * runs again (schedIn/schedAt, or not at all). Among the due tasks the one
+ * with the earliest deadline runs first, ties go to the task added first.
+ * Ticks are Timer0 overflows, SCHED_TICK_US each.
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include "global.h"
+
+#define SCHED_MAX_TASKS		4
+// Timer0 overflow with the 1024 prescaler
+#define SCHED_TICK_US		(1024UL * 256 / (F_CPU / 1000000))
+
+// milliseconds to ticks, rounded up
+#define SCHED_MS(ms)		((uint16_t)(((uint32_t)(ms) * 1000 + SCHED_TICK_US - 1) / SCHED_TICK_US))
+
+typedef uint8_t SchedTask_t;
+// returned by schedAdd when the table is full, ignored by the other calls
+#define SCHED_NONE			0xff
+
+// called from the tick interrupt
+void        schedTick(void);
+uint32_t    schedNow(void);
+
+// returns the task id (SCHED_NONE when full), tasks start stopped
+SchedTask_t schedAdd(void (*func)(void));
+// run <ticks> from now, 0 = as soon as possible
+void        schedIn(SchedTask_t task, uint16_t ticks);
+void        schedAt(SchedTask_t task, uint32_t tick);
+void        schedStop(SchedTask_t task);
+uint8_t     schedActive(SchedTask_t task);
+
+// runs the most overdue task, returns 0 when none is due
+uint8_t     schedRunOnce(void);
+// runs due tasks forever
+void        schedRun(void);
+
+#endif /* SCHED_H_ */
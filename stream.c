@@ -0,0 +1,400 @@
+/*
+ * stream.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Streamed temperature sweeps, see stream.h
+ */
+#include <string.h>
+#include "global.h"
+#include "hal.h"
+#include "rprintf.h"
+#include "cmdline.h"
+#include "json.h"
+#include "onewire.h"
+#include "sched.h"
+#include "samplelog.h"
+#include "filter.h"
+#include "health.h"
+#include "stream.h"
+
+static SchedTask_t TaskConvert, TaskOutput;
+// binary records go here, the uart on the target
+static void (*StreamOutput)(unsigned char c);
+// scheduler ticks (Timer0 overflows) between conversions, and the tick
+// of the last conversion start
+static uint16_t StreamInterval;
+static uint32_t StreamTick;
+// streaming intervals since the start, and the registry slots read next
+static uint16_t StreamCount;
+static uint32_t StreamDue;
+// hal_millis() latched at the conversion start, the time of the readings
+static uint32_t StreamTime;
+// readout ticks spent waiting for a conversion that outlasts t_conv, at
+// most one 12 bit conversion
+#define STREAM_POLL_TICKS	SCHED_MS(750)
+static uint8_t  StreamPolls;
+
+// change-only streaming: a slot is reported when its temperature moves by
+// more than StreamDeadband (1/100 C) from the last reported value, or after
+// StreamMaxSilence reads without a report (0 = never forced)
+#define STREAM_NOT_REPORTED	0xff
+static uint16_t StreamDeadband;
+static uint8_t  StreamMaxSilence;
+static int16_t  StreamLast[THERM_REGISTRY_SIZE];	// 1/16 C
+static uint8_t  StreamSilent[THERM_REGISTRY_SIZE];
+
+// binary stream (stream 2): per sweep one record
+//   type ('K' keyframe, 'D' deltas), length, time, entries, CRC8 of the above
+// time is StreamTime (u32 ms, little endian), then one entry per reported slot
+//   slot | STREAM_ABS, int16 little endian    absolute value in 1/16 C
+//   slot, zig-zag varint                     change since the last report
+//   slot | STREAM_ERR                        read error
+// Every STREAM_KEYFRAME sweeps a keyframe boundary marks every slot: its
+// next reported read is absolute, in the keyframe or (slot not read, read
+// error, filter window filling) in a later delta record. Slots without a
+// reported value are absolute too. A keyframe that has nothing to send is
+// tried again in the next sweep.
+#define STREAM_KEYFRAME		32
+#define STREAM_ABS			0x40
+#define STREAM_ERR			0x80
+static uint8_t  StreamSweeps;	// since the last keyframe
+static uint32_t StreamNeedAbs;	// slots whose next report is absolute
+
+// temperature as returned by therm_read_temp() in 1/16 C
+#define STREAM_RAW(t)		((t)[0] * 16 + (t)[1] / THERM_DECIMAL_STEPS_12BIT)
+
+static void StreamBinary(uint32_t mask);
+static void StreamLog(uint32_t mask);
+
+// every streaming interval, collects the registry slots whose own period
+// (therm_get_interval) has come round and starts one broadcast conversion
+// for all of them; the readout follows once the conversion time has passed
+// and arms the next conversion, so a short interval can not start one
+// before the last is read. The stream owns the bus from the conversion to
+// the readout, so no command lands in between.
+static void streamConvertTask(void)
+{
+	uint8_t i;
+
+	if (!Flags.stream_timer_0)
+		return;
+	if (!therm_bus_acquire(THERM_BUS_STREAM))
+	{
+		schedIn(TaskConvert, 1);
+		return;
+	}
+	StreamTick = schedNow();
+	StreamDue = 0;
+	for (i = 0; i < THERM_REGISTRY_SIZE; i++)
+	{
+		if (StreamCount % therm_get_interval(i) != 0 || !therm_load_devID(i))
+			continue;
+		// quarantined devices sit out their backoff (health.h)
+		if (healthDue(i))
+			StreamDue |= (uint32_t) 1 << i;
+	}
+	StreamCount++;
+	if (StreamDue == 0)
+	{
+		therm_bus_release(THERM_BUS_STREAM);
+		schedAt(TaskConvert, StreamTick + StreamInterval);
+		return;
+	}
+	therm_reset();
+	StreamTime = hal_millis();
+	therm_start_measurement();
+	StreamPolls = 0;
+	// the current tick is partly gone, one more makes it the full t_conv
+	schedIn(TaskOutput, SCHED_MS(therm_get_conv_time()) + 1);
+}
+
+// reads and streams the results; the stream owns the bus, so no command
+// line is executing (CmdLineLoop in main.c). The next conversion is due an
+// interval after this one started, or right away when the readout took longer
+static void streamOutputTask(void)
+{
+	// the readings belong to this conversion: externally powered DS18x20s
+	// read 0 while they convert, parasite powered ones read 1 and get t_conv
+	if (!therm_read_bit() && StreamPolls < STREAM_POLL_TICKS)
+	{
+		StreamPolls++;
+		schedIn(TaskOutput, 1);
+		return;
+	}
+	if (Flags.stream_timer_0 == STREAM_LOG)
+		StreamLog(StreamDue);
+	else if (Flags.stream_timer_0 == STREAM_BINARY)
+		StreamBinary(StreamDue);
+	else if (streamPrintTemperatures(StreamDue, 1))
+		cmdlinePrintPrompt();
+	therm_bus_release(THERM_BUS_STREAM);
+	if (Flags.stream_timer_0)
+		schedAt(TaskConvert, StreamTick + StreamInterval);
+}
+
+// forget the reported values, the next read of every slot is reported
+void streamResetReports(void)
+{
+	memset(StreamSilent, STREAM_NOT_REPORTED, sizeof(StreamSilent));
+	StreamSweeps = 0;
+	filterReset();
+}
+
+// therm_read_temp() of the loaded registry slot, counted in its health
+// record; an unsupported family says nothing about the device's health
+static uint8_t SlotRead(uint8_t slot, int16_t *t)
+{
+	uint8_t status = therm_read_temp(t);
+
+	if (status != THERM_READ_UNSUPPORTED)
+		healthUpdate(slot, status == THERM_READ_OK);
+	return status == THERM_READ_OK;
+}
+
+// deadband filter of a streamed reading in 1/16 C, returns 1 to report it
+// and makes it the last reported value of the slot
+static uint8_t StreamReport(uint8_t slot, int16_t raw)
+{
+	int16_t diff = raw - StreamLast[slot];
+
+	if (diff < 0)
+		diff = -diff;
+	if (StreamDeadband && StreamSilent[slot] != STREAM_NOT_REPORTED &&
+			(uint32_t) diff * 100 / 16 <= StreamDeadband &&
+			(StreamMaxSilence == 0 || StreamSilent[slot] < StreamMaxSilence))
+	{
+		StreamSilent[slot]++;
+		return 0;
+	}
+	StreamLast[slot]   = raw;
+	StreamSilent[slot] = 0;
+	return 1;
+}
+
+uint8_t streamPutU32(uint8_t *p, uint32_t value)
+{
+	p[0] = value;
+	p[1] = value >> 8;
+	p[2] = value >> 16;
+	p[3] = value >> 24;
+	return 4;
+}
+
+static uint8_t StreamVarint(uint8_t *p, uint16_t value)
+{
+	uint8_t n = 0;
+	while (value >= 0x80)
+	{
+		p[n++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	p[n++] = value;
+	return n;
+}
+
+// reads the slots in <mask> and sends one binary stream record
+static void StreamBinary(uint32_t mask)
+{
+	uint8_t frame[4 + THERM_REGISTRY_SIZE * 4];
+	uint8_t i, n, key, fresh;
+	int16_t t[2], raw, delta;
+
+	n = streamPutU32(frame, StreamTime);
+	key = (StreamSweeps == 0);
+	if (key)
+		StreamNeedAbs = 0xffffffff;
+	for (i = 0; i < THERM_REGISTRY_SIZE; i++)
+	{
+		if (!(mask & ((uint32_t) 1 << i)) || !therm_load_devID(i))
+			continue;
+		if (!SlotRead(i, t))
+		{
+			frame[n++] = i | STREAM_ERR;
+			continue;
+		}
+		raw   = STREAM_RAW(t);
+		// nothing while a filter window fills
+		if (!filterPut(i, &raw))
+			continue;
+		delta = raw - StreamLast[i];
+		fresh = (StreamNeedAbs & ((uint32_t) 1 << i)) ||
+				StreamSilent[i] == STREAM_NOT_REPORTED;
+		if (fresh)
+		{
+			StreamNeedAbs  &= ~((uint32_t) 1 << i);
+			StreamLast[i]   = raw;
+			StreamSilent[i] = 0;
+			frame[n++] = i | STREAM_ABS;
+			frame[n++] = raw;
+			frame[n++] = raw >> 8;
+		}
+		else if (StreamReport(i, raw))
+		{
+			frame[n++] = i;
+			n += StreamVarint(&frame[n], (uint16_t)(delta << 1) ^ (uint16_t)(delta >> 15));
+		}
+	}
+	if (n > 4)
+		streamSendFrame(key ? 'K' : 'D', frame, n);
+	// the keyframe counts once it was sent
+	else if (key)
+		return;
+	if (++StreamSweeps >= STREAM_KEYFRAME)
+		StreamSweeps = 0;
+}
+
+// binary frame: type, length, payload, CRC8 of the above
+void streamSendFrame(uint8_t type, uint8_t *payload, uint8_t n)
+{
+	uint8_t i, crc;
+
+	crc = therm_computeCRC8(type, 0);
+	crc = therm_computeCRC8(n, crc);
+	StreamOutput(type);
+	StreamOutput(n);
+	for (i = 0; i < n; i++)
+	{
+		crc = therm_computeCRC8(payload[i], crc);
+		StreamOutput(payload[i]);
+	}
+	StreamOutput(crc);
+}
+
+// reads the slots in <mask> into the sample log
+static void StreamLog(uint32_t mask)
+{
+	int16_t t[2], raw;
+	uint8_t i;
+
+	for (i = 0; i < THERM_REGISTRY_SIZE; i++)
+	{
+		if (!(mask & ((uint32_t) 1 << i)) || !therm_load_devID(i))
+			continue;
+		if (SlotRead(i, t))
+		{
+			raw = STREAM_RAW(t);
+			if (filterPut(i, &raw))
+				sampleLogPut(StreamTime, i, raw);
+		}
+		else
+			sampleLogPut(StreamTime, i | SAMPLE_LOG_ERR, 0);
+	}
+}
+
+
+static void PrintTemperaturesBegin(uint8_t stream)
+{
+	if (stream)
+		cmdlineBeginResponse(PSTR("owtemp"));
+	if(Flags.print_json)
+	{
+		jsonBegin();
+		jsonOpenArray();
+	}
+	else
+	{
+		rprintfCRLF();
+	}
+}
+// reads and prints the registry slots set in <mask>; a <stream> readout
+// is framed as "owtemp", ends each record with the conversion start time
+// (ms), passes the deadband filter and prints nothing at all when no slot
+// is reported. Returns the number of slots printed.
+uint8_t streamPrintTemperatures(uint32_t mask, uint8_t stream){
+	int16_t t[2], raw;
+	uint8_t i, no_error, loop_count=0;
+	
+	for (i = 0; i < THERM_REGISTRY_SIZE; i++)
+	{
+		if ((mask & ((uint32_t) 1 << i)) && therm_load_devID(i) == 1)
+		{
+			no_error = SlotRead(i, t);
+			// read errors are always reported, nothing while a filter
+			// window fills
+			if (stream && no_error)
+			{
+				raw = STREAM_RAW(t);
+				if (!filterPut(i, &raw) || !StreamReport(i, raw))
+					continue;
+				t[0] = raw >> 4;
+				t[1] = (raw & 15) * THERM_DECIMAL_STEPS_12BIT;
+			}
+			if (loop_count++ == 0)
+				PrintTemperaturesBegin(stream);
+			if(Flags.print_json)
+			{
+				jsonOpenArray();
+				jsonValue(); therm_print_devID();
+				jsonValue(); rprintfFixed4(t[0], t[1]);
+				jsonValue(); therm_print_scratchpad();
+				if (stream)
+					jsonULong(StreamTime);
+				jsonCloseArray();
+			}
+			else{
+				rprintf("%d : ", loop_count);
+				therm_print_devID();
+				rprintfProgStrM(" : ");
+				rprintfFixed4(t[0], t[1]);
+				rprintfProgStrM(" : ");
+				therm_print_scratchpad();
+				if (stream)
+				{
+					rprintfProgStrM(" : ");
+					rprintfNum(10, 10, FALSE, ' ', StreamTime);
+				}
+				rprintfCRLF();
+			}
+		}
+	}
+	if (loop_count == 0)
+	{
+		if (stream)
+			return 0;
+		PrintTemperaturesBegin(0);
+	}
+	if(Flags.print_json)
+		jsonCloseArray();
+	else
+		rprintfCRLF();
+	cmdlinePrintPromptEnd();
+	return loop_count;
+}
+
+void streamInit(void (*output)(unsigned char c))
+{
+	StreamOutput  = output;
+	TaskConvert   = schedAdd(streamConvertTask);
+	TaskOutput    = schedAdd(streamOutputTask);
+}
+
+void streamStart(uint8_t mode, uint16_t deadband, uint8_t max_silence)
+{
+	Flags.stream_timer_0 = mode;
+	StreamDeadband   = deadband;
+	StreamMaxSilence = max_silence;
+	if (StreamMaxSilence == STREAM_NOT_REPORTED)
+		StreamMaxSilence--;
+	streamResetReports();
+	// a stopped stream lets the pending conversion finish, a restarted one
+	// goes on with it
+	if (mode && !schedActive(TaskConvert) && !schedActive(TaskOutput))
+	{
+		StreamCount = 0;
+		schedIn(TaskConvert, 0);
+	}
+}
+
+void streamSetInterval(uint16_t ticks)
+{
+	uint16_t conv = SCHED_MS(therm_get_conv_time());
+
+	// no shorter than the conversion it waits for
+	StreamInterval = ticks < conv ? conv : ticks;
+}
+
+uint16_t streamGetInterval(void)
+{
+	return StreamInterval;
+}
@@ -0,0 +1,45 @@
+/*
+ * stream.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Streamed temperature sweeps. Every stream interval a conversion task
+ * picks the registry slots that are due (per slot period, health.h) and
+ * starts one broadcast conversion; the readout task reads them once the
+ * conversion time has passed and reports the changed values as text,
+ * binary records or into the sample log (samplelog.h). Both run from the
+ * scheduler (sched.h) and hold the bus from the conversion to the readout.
+ * The mode is kept in Flags.stream_timer_0.
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include "global.h"
+
+#define STREAM_OFF		0
+#define STREAM_TEXT		1	// "owtemp" responses
+#define STREAM_BINARY	2	// 'K'/'D' records, see stream.c
+#define STREAM_LOG		3	// readings go to the sample log, see fetch
+
+// adds the conversion and readout tasks, binary records go to <output>
+void     streamInit(void (*output)(unsigned char c));
+// starts (or with STREAM_OFF stops) the stream; a slot is reported when it
+// moves by more than <deadband> (1/100 C, 0 = every read) or after
+// <max_silence> reads without a report (0 = only on change)
+void     streamStart(uint8_t mode, uint16_t deadband, uint8_t max_silence);
+// scheduler ticks (SCHED_TICK_US) between conversions, at least the
+// conversion time of the current bus
+void     streamSetInterval(uint16_t ticks);
+uint16_t streamGetInterval(void);
+// forget the reported values, the next read of every slot is reported
+void     streamResetReports(void);
+
+// reads and prints the registry slots set in <mask>, see stream.c
+uint8_t  streamPrintTemperatures(uint32_t mask, uint8_t stream);
+// binary frame: type, length, payload, CRC8 of the above
+void     streamSendFrame(uint8_t type, uint8_t *payload, uint8_t n);
+// stores <value> little endian, returns 4
+uint8_t  streamPutU32(uint8_t *p, uint32_t value);
+
+#endif /* STREAM_H_ */
@@ -37,25 +37,35 @@ const unsigned short __attribute__ ((progmem)) TimerRTCPrescaleFactor[] = {0,1,8
 // time registers
 volatile unsigned long TimerPauseReg;
 volatile unsigned long Timer0Reg0;
+volatile unsigned long Timer1Reg0;
 volatile unsigned long Timer2Reg0;
+// milliseconds at the last Timer1 overflow, and the microseconds beyond them
+volatile static unsigned long Timer1Millis;
+volatile static unsigned short Timer1MicrosFrac;
+
+// microseconds per Timer1 overflow
+#define TIMER1_OVF_US	(65536UL/TIMER1_TICKS_PER_US)
 
 typedef void (*voidFuncPtr)(void);
 volatile static voidFuncPtr TimerIntFunc[TIMER_NUM_INTERRUPTS];
 
 // delay for a minimum of <us> microseconds
-// the time resolution is dependent on the time the loop takes
-// e.g. with 4Mhz and 5 cycles per loop, the resolution is 1.25 us
+// Timer1 must be running (timer1Init), resolution is one Timer1 tick
 void delay_us(uint16_t time_us)
 {
-	uint16_t delay_loops;
-	uint16_t i;
-
-	delay_loops = (time_us+3)/5*CYCLES_PER_US; // +3 for rounding up (dirty)
+	u16 start, ticks;
 
-	// one loop takes 5 cpu cycles
-	//for (i=0; i < delay_loops; i++) {};
-	for (i=0; i < time_us; i++) {};
+	// 16 bit tick differences cover at most 65535 ticks, split long waits
+	while (time_us > 10000)
+	{
+		delay_us(10000);
+		time_us -= 10000;
+	}
+	ticks = time_us*TIMER1_TICKS_PER_US;
+	start = TCNT1;
+	while ((u16)(TCNT1 - start) < ticks);
 }
+
 /*
 void delay_ms(unsigned char time_ms)
 {
@@ -103,9 +113,13 @@ void timer0Init()
 void timer1Init(void)
 {
 	// initialize timer 1
+	outb(TCCR1A, 0);						// normal mode, free running
 	timer1SetPrescaler( TIMER1PRESCALE );	// set prescaler
 	outb(TCNT1H, 0);						// reset TCNT1
 	outb(TCNT1L, 0);
+	Timer1Reg0 = 0;
+	Timer1Millis = 0;
+	Timer1MicrosFrac = 0;
     #ifdef TIMSK1
         sbi(TIMSK1, TOIE1);						// enable TCNT1 overflow
 	#else
@@ -262,49 +276,75 @@ u16 timerTicsToMs(u32 tics)
 	return (tics*1000*(prescaleDiv*256))/F_CPU;
 }
 */
+u32 timer1GetTicks(void)
+{
+	u08 sreg = SREG;
+	u16 tcnt;
+	u32 ovf;
+
+	cli();
+	tcnt = TCNT1;
+	ovf  = Timer1Reg0;
+	// account for an overflow that is pending but not yet counted
+	if ((TIFR1 & _BV(TOV1)) && (tcnt < 0x8000))
+		ovf++;
+	SREG = sreg;
+	return (ovf << 16) | tcnt;
+}
+
+u32 timer1GetMillis(void)
+{
+	u08 sreg = SREG;
+	u16 tcnt, frac;
+	u32 ms;
+
+	cli();
+	tcnt = TCNT1;
+	ms   = Timer1Millis;
+	frac = Timer1MicrosFrac;
+	// account for an overflow that is pending but not yet counted
+	if ((TIFR1 & _BV(TOV1)) && (tcnt < 0x8000))
+		frac += TIMER1_OVF_US;
+	SREG = sreg;
+	return ms + ((u32)frac + tcnt/TIMER1_TICKS_PER_US)/1000;
+}
+
 void timerPause(unsigned short pause_ms)
 {
-	// pauses for exactly <pause_ms> number of milliseconds
-	u08 timerThres;
-	u32 ticRateHz;
-	u32 pause;
-
-	// capture current pause timer value
-	timerThres = inb(TCNT0);
-	// reset pause timer overflow count
-	TimerPauseReg = 0;
-	// calculate delay for [pause_ms] milliseconds
-	// prescaler division = 1<<(pgm_read_byte(TimerPrescaleFactor+inb(TCCR0)))
-	ticRateHz = F_CPU/timer0GetPrescaler();
-	// precision management
-	// prevent overflow and precision underflow
-	//	-could add more conditions to improve accuracy
-	if( ((ticRateHz < 429497) && (pause_ms <= 10000)) )
-		pause = (pause_ms*ticRateHz)/1000;
-	else
-		pause = pause_ms*(ticRateHz/1000);
+	// pauses for <pause_ms> milliseconds, idling the processor until a
+	// Timer1 compare match at the deadline (or any other interrupt) wakes it
+	u32 end;
 
-	// loop until time expires
-	while( ((TimerPauseReg<<8) | inb(TCNT0)) < (pause+timerThres) )
+	// nothing can wake us with interrupts off, busy wait instead
+	if (!(SREG & _BV(SREG_I)))
 	{
-		if( TimerPauseReg < (pause>>8));
+		while (pause_ms--)
+			delay_us(1000);
+		return;
+	}
+
+	end = timer1GetTicks() + (u32)pause_ms*(1000*TIMER1_TICKS_PER_US);
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	for (;;)
+	{
+		cli();
+		if ((long)(end - timer1GetTicks()) <= 0)
+			break;
+		// arm the compare once the deadline is within one Timer1 period
+		if ((long)(end - timer1GetTicks()) <= 0xFFFF && !(TIMSK1 & _BV(OCIE1A)))
 		{
-			// save power by idling the processor
-			set_sleep_mode(SLEEP_MODE_IDLE);
-			sleep_mode();
+			OCR1A = (u16)end;
+			TIFR1 = _BV(OCF1A);
+			sbi(TIMSK1, OCIE1A);
 		}
+		// sei is followed by one more instruction, no wakeup is lost
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
 	}
-
-	/* old inaccurate code, for reference
-
-	// calculate delay for [pause_ms] milliseconds
-	u16 prescaleDiv = 1<<(pgm_read_byte(TimerPrescaleFactor+inb(TCCR0)));
-	u32 pause = (pause_ms*(F_CPU/(prescaleDiv*256)))/1000;
-
-	TimerPauseReg = 0;
-	while(TimerPauseReg < pause);
-
-	*/
+	cbi(TIMSK1, OCIE1A);
+	sei();
 }
 
 void timer0ClearOverflowCount(void)
@@ -506,12 +546,21 @@ ISR(TIMER0_OVF_vect)
 }
 
 //! Interrupt handler for tcnt1 overflow interrupt
-//ISR(TIMER1_OVF_vect)
-//{
-//	// if a user function is defined, execute it
-//	if(TimerIntFunc[TIMER1OVERFLOW_INT])
-//		TimerIntFunc[TIMER1OVERFLOW_INT]();
-//}
+ISR(TIMER1_OVF_vect)
+{
+	Timer1Reg0++;			// increment timebase high word
+	// millisecond clock, exact: carry the sub-millisecond remainder
+	Timer1Millis += TIMER1_OVF_US/1000;
+	Timer1MicrosFrac += TIMER1_OVF_US%1000;
+	if (Timer1MicrosFrac >= 1000)
+	{
+		Timer1MicrosFrac -= 1000;
+		Timer1Millis++;
+	}
+	// if a user function is defined, execute it
+	if(TimerIntFunc[TIMER1OVERFLOW_INT])
+		TimerIntFunc[TIMER1OVERFLOW_INT]();
+}
 
 #ifdef TCNT2	// support timer2 only if it exists
 //! Interrupt handler for tcnt2 overflow interrupt
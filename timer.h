@@ -156,7 +156,7 @@
 // these settings are applied when you call
 // timerInit or any of the timer<x>Init
 #define TIMER0PRESCALE		TIMER_CLK_DIV8		///< timer 0 prescaler default
-#define TIMER1PRESCALE		TIMER_CLK_DIV1		///< timer 1 prescaler default
+#define TIMER1PRESCALE		TIMER_CLK_DIV8		///< timer 1 prescaler default (timebase)
 #define TIMER2PRESCALE		TIMERRTC_CLK_DIV64	///< timer 2 prescaler default
 
 // interrupt macros for attaching user functions to timer interrupts
@@ -190,9 +190,13 @@
 #define TIMER_INTERRUPT_HANDLER		ISR
 #endif
 
+// Timer1 free runs as the system timebase, TIMER1_TICKS_PER_US ticks per us
+#define TIMER1_TICKS_PER_US		(F_CPU/8000000)
+
 // functions
 #define delay		delay_us
 #define delay_ms	timerPause
+/// busy waits <time_us> microseconds on the Timer1 timebase
 void delay_us(uint16_t time_us);
 
 //! initializes timing system (all timers)
@@ -257,9 +261,16 @@ void timerDetach(u08 interruptNum);
 
 // timing commands
 /// A timer-based delay/pause function
+/// Idles the processor between interrupts (UART keeps receiving) and wakes
+/// on a Timer1 compare at the deadline.
 /// @param pause_ms	Number of integer milliseconds to wait.
 void timerPause(unsigned short pause_ms);
 
+/// Timer1 timebase: overflow count in the high word, TCNT1 in the low word
+u32  timer1GetTicks(void);
+/// Monotonic milliseconds since timer1Init() (wraps after 49 days)
+u32  timer1GetMillis(void);
+
 // overflow counters
 void timer0ClearOverflowCount(void);	///< Clear timer0's overflow counter.
 long timer0GetOverflowCount(void);		///< read timer0's overflow counter
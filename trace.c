@@ -0,0 +1,65 @@
+/*
+ * trace.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * 1-Wire event trace ring, see trace.h
+ */
+#include "global.h"
+#include "hal.h"
+#include "trace.h"
+
+#ifdef THERM_TRACE
+
+// oldest records are overwritten when the ring is full
+static TraceRecord_t TraceRing[TRACE_SIZE];
+static uint8_t TraceHead;		// next record to write
+static uint8_t TraceCount;		// records held
+
+static void traceStore(uint8_t event, uint8_t data, uint16_t tick)
+{
+	TraceRecord_t *rec;
+	CRITICAL_SECTION_START;
+	rec = &TraceRing[TraceHead];
+	rec->event = event;
+	rec->data  = data;
+	rec->tick  = tick;
+	TraceHead  = (TraceHead + 1) & (TRACE_SIZE - 1);
+	if (TraceCount < TRACE_SIZE)
+		TraceCount++;
+	CRITICAL_SECTION_END;
+}
+
+void traceRecord(uint8_t event, uint8_t data)
+{
+	traceStore(event, data, HAL_TICKS16());
+}
+
+void traceEpoch(void)
+{
+	uint32_t t = hal_ticks();
+	traceStore(TRACE_EV_EPOCH, (uint8_t)(t >> 8), t >> 16);
+}
+
+uint8_t traceGet(TraceRecord_t *rec)
+{
+	uint8_t found = 0;
+	CRITICAL_SECTION_START;
+	if (TraceCount)
+	{
+		*rec = TraceRing[(TraceHead - TraceCount) & (TRACE_SIZE - 1)];
+		TraceCount--;
+		found = 1;
+	}
+	CRITICAL_SECTION_END;
+	return found;
+}
+
+void traceClear(void)
+{
+	CRITICAL_SECTION_START;
+	TraceCount = 0;
+	CRITICAL_SECTION_END;
+}
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * trace.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Optional 1-Wire event trace, enabled by defining THERM_TRACE (global.h).
+ * onewire.c records resets, presence, read slot samples, bytes and CRC
+ * results into a RAM ring of TRACE_SIZE records, timestamped with the low
+ * word of the Timer1 timebase (0.5 us ticks). Each reset is preceded by
+ * an EPOCH record carrying the high word, so the full time can be rebuilt
+ * as long as events between resets are less than one wrap (32 ms) apart.
+ * The "trace" command dumps the ring, host/trace2vcd turns it into VCD.
+ * Without THERM_TRACE the TRACE() calls compile to nothing.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "global.h"
+
+// events, data byte in brackets
+#define TRACE_EV_EPOCH		0	// tick holds the high word of the timebase [bits 8..15]
+#define TRACE_EV_RESET		1	// master pulls the bus low for a reset
+#define TRACE_EV_PRESENCE	2	// end of reset [0 = presence seen]
+#define TRACE_EV_SAMPLE		3	// read slot sample [bit]
+#define TRACE_EV_READ		4	// byte read [byte]
+#define TRACE_EV_WRITE		5	// byte written [byte]
+#define TRACE_EV_CRC		6	// CRC check of a bus read [1 = ok]
+
+// ring size in records (power of two), 4 bytes each
+#define TRACE_SIZE			64
+
+typedef struct
+{
+	uint8_t  event;
+	uint8_t  data;
+	uint16_t tick;
+} TraceRecord_t;
+
+#ifdef THERM_TRACE
+
+#define TRACE(event, data)	traceRecord(event, data)
+#define TRACE_EPOCH()		traceEpoch()
+
+void    traceRecord(uint8_t event, uint8_t data);
+void    traceEpoch(void);
+// copies out the oldest record, returns 0 when the ring is empty
+uint8_t traceGet(TraceRecord_t *rec);
+void    traceClear(void);
+
+#else
+
+#define TRACE(event, data)
+#define TRACE_EPOCH()
+
+#endif
+
+#endif /* TRACE_H_ */
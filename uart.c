@@ -30,6 +30,7 @@ volatile u08   uartBufferedTx;		///< uartBufferedTx flag
 cBuffer uartRxBuffer;				///< uart receive buffer
 cBuffer uartTxBuffer;				///< uart transmit buffer
 unsigned short uartRxOverflow;		///< receive overflow counter
+unsigned long uartTxStall;			///< transmit busy-wait loop counter
 
 #ifndef UART_BUFFERS_EXTERNAL_RAM
 	// using internal ram,
@@ -65,6 +66,7 @@ void uartInit(void)
 	uartBufferedTx = FALSE;
 	// clear overflow count
 	uartRxOverflow = 0;
+	uartTxStall = 0;
 	// enable interrupts
 	sei();
 }
@@ -120,7 +122,9 @@ cBuffer* uartGetTxBuffer(void)
 // transmits a byte over the uart
 void uartSendByte(u08 txData)
 {
-	loop_until_bit_is_set(UCSR0A, UDRE0);
+	// count the loops spent waiting for the transmitter
+	while(bit_is_clear(UCSR0A, UDRE0))
+		uartTxStall++;
     UDR0 = txData;
 	// set ready state to FALSE
 	uartReadyTx = FALSE;
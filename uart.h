@@ -185,6 +185,11 @@ cBuffer* uartGetRxBuffer(void);
 ///
 cBuffer* uartGetTxBuffer(void);
 
+//! Receive overflow counter, bytes lost while the receive buffer was full.
+extern unsigned short uartRxOverflow;
+//! Transmit stall counter, busy-wait loops in uartSendByte() (about 8 cycles each).
+extern unsigned long uartTxStall;
+
 //! Sends a single byte over the uart.
 /// \note This function waits for the uart to be ready,
 /// therefore, consecutive calls to uartSendByte() will